@@ -0,0 +1,98 @@
+// End-to-end Actor::dispatch: latency percentiles of a lone message (the sender waits for each one
+// to run) and messages per second of a saturating sender, for every Thread<> mailbox and for a
+// Strand on a one-worker Executor, with an inline (32-byte) and a pool-spilled (128-byte) capture.
+//   g++ -std=c++11 -O2 -pthread -I smunix/include -I bench bench/actor.cc -o actor.bench
+// Actor::dispatch logs at trace level; logging is compiled out unless SMUNIX_LOG_LEVEL is given.
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <actor.hh>
+#include <bench.hh>
+
+namespace {
+  constexpr size_t L = 1 << 15; // latency samples
+  constexpr size_t M = 1 << 19; // throughput messages
+
+  int64_t now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(bench::Clock::now().time_since_epoch()).count(); }
+
+  template<class E, size_t C> void latency(const char* name, E& exec) {
+    BasicActor<E> actor(exec);
+    std::vector<int64_t> ns(L);
+    std::atomic<size_t> done {0};
+    std::array<char, C - 3 * sizeof(void*)> ar {};
+    for (size_t i = 0; i < L; ++i) {
+      int64_t* slot = &ns[i];
+      std::atomic<size_t>* d = &done;
+      int64_t t0 = now();
+      actor.dispatch([ar, slot, d, t0]() {
+          bench::escape(ar);
+          *slot = now() - t0;
+          d->store(d->load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        });
+      while (done.load(std::memory_order_acquire) != i + 1)
+        std::this_thread::yield();
+    }
+    std::sort(ns.begin(), ns.end());
+    auto p = [&](double q) { return ns[std::min(L - 1, size_t(q * L))]; };
+    std::printf("%-10s capture=%-4zu latency ns: p50=%-7lld p90=%-7lld p99=%-7lld p99.9=%-7lld max=%lld\n", name, C,
+                (long long)p(0.5), (long long)p(0.9), (long long)p(0.99), (long long)p(0.999), (long long)ns.back());
+  }
+
+  template<class E, size_t C> void throughput(const char* name, E& exec) {
+    BasicActor<E> actor(exec);
+    size_t done = 0; // only touched by the receiver
+    std::atomic<bool> finished {false};
+    std::array<char, C - 3 * sizeof(void*)> ar {};
+    auto t0 = bench::Clock::now();
+    for (size_t i = 0; i < M; ++i) {
+      size_t* d = &done;
+      std::atomic<bool>* f = &finished;
+      actor.dispatch([ar, d, f]() {
+          bench::escape(ar);
+          if (++*d == M)
+            f->store(true, std::memory_order_release);
+        });
+    }
+    while (not finished.load(std::memory_order_acquire))
+      std::this_thread::yield();
+    auto t1 = bench::Clock::now();
+    double s = std::chrono::duration<double>(t1 - t0).count();
+    std::printf("%-10s capture=%-4zu %12.0f msg/s %10.2f ns/msg\n", name, C, M / s, 1e9 * s / M);
+  }
+
+  template<class TT> void thread(const char* name) {
+    {
+      Thread<TT> t;
+      latency<Thread<TT>, 32>(name, t);
+      latency<Thread<TT>, 128>(name, t);
+    }
+    {
+      Thread<TT> t;
+      throughput<Thread<TT>, 32>(name, t);
+      throughput<Thread<TT>, 128>(name, t);
+    }
+  }
+
+  template<size_t C> void strand(const char* name, bool lat) {
+    sched::Executor executor(1);
+    sched::Strand s(executor);
+    if (lat)
+      latency<sched::Strand, C>(name, s);
+    else
+      throughput<sched::Strand, C>(name, s);
+  }
+} // namespace
+
+int main() {
+  thread<ThreadTraits>("locked");
+  thread<MpscThreadTraits>("mpsc");
+  thread<RingThreadTraits>("ring");
+  strand<32>("strand", true);
+  strand<128>("strand", true);
+  strand<32>("strand", false);
+  strand<128>("strand", false);
+  return 0;
+}
@@ -0,0 +1,68 @@
+// One producer posting to a Thread<> dispatcher message by message with exec() and in batches of
+// B with exec_many(), for every mailbox queue, including a bounded one under each overflow policy.
+// A producer outrunning the dispatcher fills the bounded mailbox, so the fail and drop rows mostly
+// time refused and discarded messages.
+//   g++ -std=c++11 -O2 -pthread -I smunix/include -I bench bench/batch.cc -o batch.bench
+#include <vector>
+#include <thread.hh>
+#include <bench.hh>
+
+namespace {
+  constexpr size_t M = 1 << 19; // messages
+
+  struct Count {
+    size_t* done;
+    std::atomic<size_t>* seen;
+    void operator()() {
+      if (++*done == M)
+        seen->store(M, std::memory_order_release);
+    }
+  };
+
+  template<class TT> double run(size_t batch) {
+    size_t done = 0; // only touched by the dispatcher
+    std::atomic<size_t> seen {0};
+    Thread<TT> thread;
+    std::vector<Count> b(batch, Count {&done, &seen});
+    size_t refused = 0;
+    auto t0 = bench::Clock::now();
+    for (size_t i = 0; i < M; i += batch) {
+      queue::Status s = batch == 1 ? thread.exec(Count {&done, &seen}) : thread.exec_many(b.begin(), b.end());
+      refused += s == queue::Full ? batch : 0;
+    }
+    // Refused and dropped messages never run; count them as done so the wait ends.
+    if (refused or thread.counters().dropped) {
+      thread.stop();
+      seen.store(M);
+    }
+    while (seen.load(std::memory_order_acquire) != M)
+      std::this_thread::yield();
+    auto t1 = bench::Clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / M;
+  }
+
+  template<class TT> void report(const char* name) {
+    std::printf("%-18s", name);
+    for (size_t batch: {1, 8, 64}) {
+      double best = 0;
+      for (int r = 0; r < 3; ++r) {
+        double ns = run<TT>(batch);
+        if (r == 0 or ns < best)
+          best = ns;
+      }
+      std::printf(" %10.2f", best);
+    }
+    std::printf("\n");
+  }
+} // namespace
+
+int main() {
+  std::printf("%-18s %10s %10s %10s  (ns/msg)\n", "mailbox", "exec", "batch=8", "batch=64");
+  report<ThreadTraits>("locked");
+  report<MpscThreadTraits>("mpsc");
+  report<RingThreadTraits>("ring");
+  report<BoundedThreadTraits<1024, queue::Block>>("bounded/block");
+  report<BoundedThreadTraits<1024, queue::Fail>>("bounded/fail");
+  report<BoundedThreadTraits<1024, queue::DropOldest>>("bounded/drop");
+  return 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <utility>
+
+// Minimal timing harness shared by the benchmarks in this directory.
+//   g++ -std=c++11 -O2 -pthread -I smunix/include -I bench bench/<name>.cc
+namespace bench {
+  using Clock = std::chrono::steady_clock;
+
+  // Keep the optimizer from discarding a value or the stores leading up to it.
+  template<class T> inline void escape(T const& t) { asm volatile("" : : "g"(&t) : "memory"); }
+  inline void clobber() { asm volatile("" : : : "memory"); }
+
+  // Best of `reps` runs of n iterations; the minimum is the least noisy estimate on a shared box.
+  template<class F> double measure(size_t n, F&& f, size_t reps = 5) {
+    double best = 0;
+    for (size_t r = 0; r < reps; ++r) {
+      auto t0 = Clock::now();
+      for (size_t i = 0; i < n; ++i)
+        f(i);
+      auto t1 = Clock::now();
+      double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+      if (r == 0 or ns < best)
+        best = ns;
+    }
+    return best;
+  }
+
+  template<class F> double apply(const char* name, size_t n, F&& f, size_t reps = 5) {
+    double best = measure(n, std::forward<F>(f), reps);
+    std::printf("%-48s %10.2f ns/op\n", name, best);
+    return best;
+  }
+} // bench
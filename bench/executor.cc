@@ -0,0 +1,76 @@
+// Actor throughput: A actors on one Thread<> each vs. the same actors as Strands on an M-worker
+// work-stealing Executor, with every actor forwarding to the next one (actor-to-actor traffic).
+//   g++ -std=c++11 -O2 -pthread -I smunix/include -I bench bench/executor.cc -o executor.bench
+#include <vector>
+#include <executor.hh>
+#include <thread.hh>
+#include <bench.hh>
+
+namespace {
+  constexpr size_t A = 64;       // actors
+  constexpr size_t M = 1 << 12;  // messages injected per actor
+  constexpr size_t Hops = 4;     // each message is forwarded this many times
+  constexpr size_t Work = 200;   // busy loop per message
+
+  template<class T> struct Ring {
+    std::vector<T*> actors;
+    std::atomic<size_t> done {0};
+
+    void hop(size_t a, size_t left) {
+      size_t x = 0;
+      for (size_t i = 0; i < Work; ++i)
+        bench::escape(x += i);
+      if (left)
+        actors[(a + 1) % A]->exec([this, a, left]() { hop((a + 1) % A, left - 1); });
+      else
+        done.fetch_add(1, std::memory_order_relaxed);
+    }
+    double run() {
+      auto t0 = bench::Clock::now();
+      for (size_t i = 0; i < M; ++i)
+        for (size_t a = 0; a < A; ++a)
+          actors[a]->exec([this, a]() { hop(a, Hops); });
+      while (done.load(std::memory_order_relaxed) != A * M)
+        std::this_thread::yield();
+      auto t1 = bench::Clock::now();
+      return std::chrono::duration<double>(t1 - t0).count();
+    }
+  };
+
+  void report(const char* name, double s) {
+    std::printf("%-28s %8.3f s %12.0f msg/s\n", name, s, A * M * (Hops + 1) / s);
+  }
+
+  void dedicated() {
+    std::vector<std::unique_ptr<Thread<>>> threads;
+    Ring<Thread<>> ring;
+    for (size_t a = 0; a < A; ++a) {
+      threads.emplace_back(new Thread<>);
+      ring.actors.push_back(threads.back().get());
+    }
+    report("dedicated threads=64", ring.run());
+  }
+
+  void stealing(size_t workers) {
+    sched::Executor executor(workers);
+    std::vector<std::unique_ptr<sched::Strand>> strands;
+    Ring<sched::Strand> ring;
+    for (size_t a = 0; a < A; ++a) {
+      strands.emplace_back(new sched::Strand(executor));
+      ring.actors.push_back(strands.back().get());
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "stealing workers=%zu", workers);
+    report(name, ring.run());
+  }
+} // namespace
+
+int main() {
+  dedicated();
+  size_t n = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t w = 1; w <= n; w *= 2)
+    stealing(w);
+  if (n & (n - 1))
+    stealing(n);
+  return 0;
+}
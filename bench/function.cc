@@ -0,0 +1,116 @@
+// Closure wrapper costs: construct, copy, move, swap and invoke for smunix::function<void(), Sz>
+// across inline buffer sizes (Sz pointers) and capture sizes, against std::function<void()> and
+// func::make (smunix::function<void()> with the per-thread pool allocator); then the Thread<>
+// queue hand-off for the Element type.
+//   g++ -std=c++11 -O2 -pthread -I smunix/include -I bench bench/function.cc -o function.bench
+// The allocator hooks log at trace level; logging is compiled out unless SMUNIX_LOG_LEVEL is given.
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <deque>
+#include <mutex>
+#include <array>
+#include <functional>
+#include <functional.hh>
+#include <bench.hh>
+
+namespace {
+  constexpr size_t N = 1 << 18;
+
+  template<size_t Sz> struct Smunix {
+    using type = smunix::function<void(), Sz>;
+    template<class L> static type make(L&& l) { return type(std::forward<L>(l)); }
+    static const char* name() {
+      static char s[32];
+      std::snprintf(s, sizeof(s), "smunix::function<_, %zu>", Sz);
+      return s;
+    }
+  };
+
+  struct Std {
+    using type = std::function<void()>;
+    template<class L> static type make(L&& l) { return type(std::forward<L>(l)); }
+    static const char* name() { return "std::function"; }
+  };
+
+  struct Make {
+    using type = func::function<void()>;
+    template<class L> static type make(L&& l) { return func::make<void()>(std::forward<L>(l)); }
+    static const char* name() { return "func::make"; }
+  };
+
+  // A copyable closure of exactly C bytes.
+  template<size_t C> struct Capture {
+    template<class W> static typename W::type apply(size_t& sink) {
+      std::array<char, C - sizeof(size_t*)> ar {};
+      size_t* s = &sink;
+      return W::make([ar, s]() { *s += ar[0] + 1; });
+    }
+  };
+
+  template<class F> __attribute__((noinline)) void call(F const& f) { f(); }
+
+  template<class W, size_t C> void row() {
+    using F = typename W::type;
+    size_t sink = 0;
+    F f = Capture<C>::template apply<W>(sink);
+    F h = Capture<C>::template apply<W>(sink);
+
+    double construct = bench::measure(N, [&](size_t) { F g = Capture<C>::template apply<W>(sink); bench::escape(g); });
+    double copy = bench::measure(N, [&](size_t) { F g(f); bench::escape(g); });
+    double move = bench::measure(N, [&](size_t) { F g(std::move(f)); f = std::move(g); bench::escape(f); });
+    double swap = bench::measure(N, [&](size_t) { f.swap(h); bench::escape(f); });
+    double invoke = bench::measure(N, [&](size_t) { call(f); });
+    bench::escape(sink);
+    std::printf("%-26s %7zu %10.2f %10.2f %10.2f %10.2f %10.2f\n", W::name(), C, construct, copy, move, swap, invoke);
+  }
+
+  template<size_t C> void rows() {
+    row<Smunix<2>, C>();
+    row<Smunix<4>, C>();
+    row<Smunix<8>, C>();
+    row<Smunix<16>, C>();
+    row<Std, C>();
+    row<Make, C>();
+  }
+
+  // Same hand-off as Thread<>::push/process, minus the dispatcher thread.
+  template<size_t C> void handoff() {
+    using W = Smunix<8>;
+    char name[64];
+    size_t sink = 0;
+    std::mutex m;
+    std::deque<W::type> queue;
+    std::snprintf(name, sizeof(name), "push/process capture=%zu", C);
+    bench::apply(name, N, [&](size_t) {
+        W::type e = Capture<C>::template apply<W>(sink);
+        {
+          std::unique_lock<std::mutex> l(m);
+          queue.push_back(std::move(e));
+        }
+        W::type r;
+        {
+          std::unique_lock<std::mutex> l(m);
+          std::swap(r, queue.front());
+          queue.pop_front();
+        }
+        r();
+      });
+    bench::escape(sink);
+  }
+} // namespace
+
+int main() {
+  std::printf("%-26s %7s %10s %10s %10s %10s %10s  (ns/op)\n", "wrapper", "capture", "construct", "copy", "move", "swap", "invoke");
+  rows<16>();
+  rows<32>();
+  rows<56>();
+  rows<128>();
+  rows<256>();
+  std::printf("\n");
+  handoff<16>();
+  handoff<32>();
+  handoff<56>();
+  handoff<128>();
+  return 0;
+}
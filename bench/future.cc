@@ -0,0 +1,83 @@
+// Request/reply round trips to an actor: ask() and get() against a std::promise captured in
+// dispatch(), and, built as C++20, a coroutine on one actor awaiting ask() on another.
+// Reports ns per round trip and pool / global heap allocations per round trip.
+//   g++ -std=c++11 -O2 -pthread -I smunix/include -I bench bench/future.cc -o future.bench
+//   g++ -std=c++20 -O2 -pthread -I smunix/include -I bench bench/future.cc -o future.bench
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <atomic>
+#include <cstdlib>
+#include <future>
+#include <new>
+#include <actor.hh>
+#include <bench.hh>
+
+namespace {
+  std::atomic<uint64_t> news {0};
+} // namespace
+
+void* operator new(size_t n) {
+  news.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1))
+    return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+  constexpr size_t N = 1 << 15;
+
+  using Mpsc = Thread<MpscThreadTraits>;
+
+  template<class F> void row(const char* name, F&& f) {
+    pool::Stats p0 = pool::stats();
+    uint64_t n0 = news.load();
+    auto t0 = bench::Clock::now();
+    f();
+    auto t1 = bench::Clock::now();
+    pool::Stats p1 = pool::stats();
+    uint64_t n1 = news.load();
+    std::printf("%-22s %10.0f ns/round trip %6.2f pool %6.2f new\n", name, std::chrono::duration<double, std::nano>(t1 - t0).count() / N,
+                double(p1.allocations + p1.large - p0.allocations - p0.large) / N, double(n1 - n0) / N);
+  }
+
+#if SMUNIX_COROUTINES
+  future::Future<void> loop(BasicActor<Mpsc>& to, std::atomic<bool>& done) {
+    size_t sum = 0;
+    for (size_t i = 0; i < N; ++i)
+      sum += co_await to.ask([i]() { return i; });
+    bench::escape(sum);
+    done.store(true, std::memory_order_release);
+  }
+#endif
+} // namespace
+
+int main() {
+  Mpsc t1, t2;
+  BasicActor<Mpsc> a(t1), b(t2);
+  a.ask([]() { return 0; }).get(); // warm the pools
+  row("ask/get", [&]() {
+      for (size_t i = 0; i < N; ++i)
+        bench::escape(a.ask([i]() { return i; }).get());
+    });
+  row("dispatch+std::promise", [&]() {
+      for (size_t i = 0; i < N; ++i) {
+        std::promise<size_t> p;
+        std::future<size_t> f = p.get_future();
+        std::promise<size_t>* q = &p;
+        a.dispatch([q, i]() { q->set_value(i); });
+        bench::escape(f.get());
+      }
+    });
+#if SMUNIX_COROUTINES
+  row("co_await ask (hop)", [&]() {
+      std::atomic<bool> done {false};
+      b.dispatch([&]() { loop(a, done); });
+      while (not done.load(std::memory_order_acquire))
+        std::this_thread::yield();
+    });
+#endif
+  return 0;
+}
@@ -0,0 +1,83 @@
+// Dispatch-to-execution latency of a lone message (the sender waits for each one to run) under
+// every Thread<> idle strategy, for the locked and the mpsc mailbox, plus the CPU time the
+// dispatcher burns meanwhile.
+//   g++ -std=c++11 -O2 -pthread -I smunix/include -I bench bench/idle.cc -o idle.bench
+//   ./idle.bench [dispatcher-cpu [sender-cpu]]
+// Polling strategies need the dispatcher and the sender on different CPUs; on a single CPU the
+// sender only runs when the spinner yields or is preempted, so their numbers mean little there.
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+#include <actor.hh>
+#include <bench.hh>
+
+namespace {
+  constexpr size_t L = 1 << 14; // latency samples
+  Placement placement;
+
+  int64_t now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(bench::Clock::now().time_since_epoch()).count(); }
+
+  double cpu(clockid_t c) {
+    timespec ts;
+    clock_gettime(c, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+  }
+
+  template<class TT, class S> void latency(const char* queue, const char* strategy) {
+    using T = Thread<TT, true, S>;
+    T t(true, placement);
+    BasicActor<T> actor(t);
+    std::vector<int64_t> ns(L);
+    std::atomic<size_t> done {0};
+    clockid_t c;
+    actor.dispatch([&c]() { pthread_getcpuclockid(pthread_self(), &c); });
+    auto t0 = bench::Clock::now();
+    double c0 = 0;
+    actor.dispatch([&c0, &c, &done]() { c0 = cpu(c); done.store(1, std::memory_order_release); });
+    while (done.load(std::memory_order_acquire) != 1)
+      std::this_thread::yield();
+    for (size_t i = 0; i < L; ++i) {
+      int64_t* slot = &ns[i];
+      std::atomic<size_t>* d = &done;
+      int64_t s = now();
+      actor.dispatch([slot, d, s]() {
+          *slot = now() - s;
+          d->store(d->load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        });
+      while (done.load(std::memory_order_acquire) != i + 2)
+        std::this_thread::yield();
+    }
+    double busy = cpu(c) - c0;
+    double wall = std::chrono::duration<double>(bench::Clock::now() - t0).count();
+    std::sort(ns.begin(), ns.end());
+    auto p = [&](double q) { return ns[std::min(L - 1, size_t(q * L))]; };
+    std::printf("%-7s %-10s latency ns: p50=%-8lld p90=%-8lld p99=%-8lld p99.9=%-8lld max=%-9lld dispatcher cpu=%3.0f%%\n",
+                queue, strategy, (long long)p(0.5), (long long)p(0.9), (long long)p(0.99), (long long)p(0.999), (long long)ns.back(),
+                100 * busy / wall);
+  }
+
+  template<class TT> void strategies(const char* queue) {
+    latency<TT, idle::Block>(queue, "block");
+    latency<TT, idle::Adaptive<>>(queue, "adaptive");
+    latency<TT, idle::SpinYield<>>(queue, "spin-yield");
+    latency<TT, idle::Spin>(queue, "spin");
+  }
+} // namespace
+
+int main(int argc, char** argv) {
+  placement.name = "idle.bench";
+  if (argc > 1)
+    placement.cpu = std::atoi(argv[1]);
+  if (argc > 2) {
+    Placement sender;
+    sender.cpu = std::atoi(argv[2]);
+    sender.apply();
+  }
+  strategies<ThreadTraits>("locked");
+  strategies<MpscThreadTraits>("mpsc");
+  return 0;
+}
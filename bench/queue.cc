@@ -0,0 +1,61 @@
+// Thread<> mailbox contention: 1..N producers fanning into one dispatcher, for each mailbox queue
+// and for a small (32-byte) and a large (200-byte, heap-spilled by smunix::function<_, 8>) capture.
+//   g++ -std=c++11 -O2 -pthread -I smunix/include -I bench bench/queue.cc -o queue.bench
+#include <array>
+#include <vector>
+#include <thread.hh>
+#include <bench.hh>
+
+namespace {
+  constexpr size_t M = 1 << 17; // messages per producer
+
+  template<class TT, size_t C> double run(size_t producers) {
+    size_t done = 0;            // only touched by the dispatcher
+    std::atomic<size_t> seen {0};
+    const size_t total = producers * M;
+    Thread<TT> thread;
+    auto t0 = bench::Clock::now();
+    std::vector<std::thread> ps;
+    for (size_t p = 0; p < producers; ++p)
+      ps.emplace_back([&]() {
+          std::array<char, C - 2 * sizeof(void*)> ar {};
+          for (size_t i = 0; i < M; ++i)
+            thread.exec([&done, &seen, total, ar]() {
+                bench::escape(ar);
+                if (++done == total)
+                  seen.store(done, std::memory_order_release);
+              });
+        });
+    for (auto& p: ps)
+      p.join();
+    while (seen.load(std::memory_order_acquire) != total)
+      std::this_thread::yield();
+    auto t1 = bench::Clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / total;
+  }
+
+  template<class TT, size_t C> void report(const char* name, size_t producers) {
+    double best = 0;
+    for (int r = 0; r < 3; ++r) {
+      double ns = run<TT, C>(producers);
+      if (r == 0 or ns < best)
+        best = ns;
+    }
+    std::printf("%-8s capture=%-4zu producers=%-3zu %10.2f ns/msg %12.0f msg/s\n", name, C, producers, best, 1e9 / best);
+  }
+
+  template<size_t C> void all(size_t producers) {
+    report<ThreadTraits, C>("locked", producers);
+    report<MpscThreadTraits, C>("mpsc", producers);
+    report<RingThreadTraits, C>("ring", producers);
+  }
+} // namespace
+
+int main() {
+  size_t n = std::max<size_t>(4, std::thread::hardware_concurrency());
+  for (size_t p = 1; p <= n; p *= 2) {
+    all<32>(p);
+    all<200>(p);
+  }
+  return 0;
+}
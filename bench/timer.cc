@@ -0,0 +1,71 @@
+// Timer wheel cost per timeout on the dispatcher side: schedule + cancel (the common fate of a
+// request timeout) and schedule + fire, against a binary heap of std::function as the baseline.
+//   g++ -std=c++11 -O2 -pthread -I smunix/include -I bench bench/timer.cc -o timer.bench
+#include <functional>
+#include <queue>
+#include <timer.hh>
+#include <functional.H>
+#include <bench.hh>
+
+namespace {
+  constexpr size_t N = 1 << 18;
+  using Element = smunix::function<void(), 8>;
+  using Clock = timer::Clock;
+
+  struct Heap {
+    struct Entry {
+      Clock::time_point at;
+      uint64_t seq;
+      std::function<void()> f;
+      bool operator<(const Entry& o) const { return at > o.at or (at == o.at and seq > o.seq); }
+    };
+    std::priority_queue<Entry> q;
+    uint64_t seq = 0;
+    void expire(Clock::time_point t) {
+      while (not q.empty() and q.top().at <= t) {
+        q.top().f();
+        q.pop();
+      }
+    }
+  };
+} // namespace
+
+int main() {
+  size_t sink = 0;
+  size_t* s = &sink;
+  {
+    timer::Wheel<Element> w;
+    Clock::time_point t0 = Clock::now();
+    bench::apply("wheel schedule+cancel", N, [&](size_t i) {
+        timer::Base* n = w.make(t0 + std::chrono::milliseconds(1 + i % 5000), Clock::duration::zero(), [s]() { ++*s; });
+        timer::Handle h(n);
+        w.insert(n);
+        h.cancel();
+        if (i % 64 == 63)
+          w.expire(t0);
+      }, 1);
+  }
+  {
+    timer::Wheel<Element> w;
+    Clock::time_point t0 = Clock::now();
+    bench::apply("wheel schedule+fire", N, [&](size_t i) {
+        timer::Base* n = w.make(t0 + std::chrono::microseconds(i), Clock::duration::zero(), [s]() { ++*s; });
+        timer::Handle h(n);
+        w.insert(n);
+        if (i % 64 == 63)
+          w.expire(t0 + std::chrono::microseconds(i));
+      }, 1);
+  }
+  {
+    Heap h;
+    Clock::time_point t0 = Clock::now();
+    bench::apply("heap<std::function> schedule+fire", N, [&](size_t i) {
+        h.q.push(Heap::Entry {t0 + std::chrono::microseconds(i), h.seq++, [s]() { ++*s; }});
+        if (i % 64 == 63)
+          h.expire(t0 + std::chrono::microseconds(i));
+      }, 1);
+    h.expire(Clock::time_point::max());
+  }
+  bench::escape(sink);
+  return 0;
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <executor.hh>
+#include <future.hh>
+#include <log.hh>
+#include <pool.hh>
+#include <thread.hh>
+
+// An actor posts its messages to TExec, either a dedicated Thread<> or a Strand on a shared Executor.
+template<class TExec> struct BasicActor {
+  template<class A> using up = std::unique_ptr<A>;
+  template<class A> using sp = std::shared_ptr<A>;
+  template<class A> using seq = std::vector<A>;
+  using Element = typename TExec::Element;
+
+  template <class T>
+  struct Custom {
+    using value_type = T;
+    Custom() noexcept {}
+    template <class U> Custom (const Custom<U>&) noexcept {
+    }
+    T* allocate (std::size_t n) {
+      auto r = static_cast<T*>(pool::allocate(n*sizeof(value_type)));
+      log_trace(r << ", " << n << ", " << n*sizeof(value_type));
+      return r;
+    }
+    void deallocate (T* p, std::size_t n) {
+      log_trace(p << ", " << n << ", " << n * sizeof(value_type));
+      pool::deallocate(p, n * sizeof(value_type));
+    }
+    template<class V> struct rebind {
+      using other = Custom<V>;
+    };
+  };
+  // A forward iterator over closures that yields them wrapped in Elements built with the actor's
+  // allocator, moving from the closures.
+  template<class It> struct Wrap {
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Element;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Element*;
+    using reference = Element;
+    It it;
+    Custom<Element>* alloc;
+    Element operator*() const { return Element(std::allocator_arg, *alloc, std::move(*it)); }
+    Wrap& operator++() {
+      ++it;
+      return *this;
+    }
+    Wrap operator++(int) {
+      Wrap w(*this);
+      ++it;
+      return w;
+    }
+    bool operator==(const Wrap& o) const { return it == o.it; }
+    bool operator!=(const Wrap& o) const { return it != o.it; }
+  };
+  TExec& thread;
+  Custom<Element> alloc;
+
+  BasicActor(TExec& thread) : thread(thread) {}
+  template<class F> queue::Status dispatch(F&& f) {
+#if 1
+    // Trace only: these run on every dispatch. Types are logged by id, not as demangled strings.
+    log_trace(this << ", sizeof(f)=" << sizeof(f) << ", (4*sizeof(void*))=" << 4*(sizeof(void*)));
+    log_trace(std::boolalpha << "std::is_nothrow_move_constructible<" << logging::type<F>() << ">::value=" << std::is_nothrow_move_constructible<F>::value);
+    log_trace(std::boolalpha << "std::is_nothrow_move_constructible<" << logging::type<Custom<Element>>() << ">::value=" << std::is_nothrow_move_constructible<Custom<Element>>::value);
+    using _Fp = typename std::decay<F>::type;
+    using _Alloc = Custom<Element>;
+    typedef smunix::details::function::func<_Fp, _Alloc, void()> _FF;
+    log_trace("sizeof(" << logging::type<_FF>() << ")=" << sizeof(_FF) << ", sizeof(Element::__buf_)=" << sizeof(Element::__buf_) << ", typeof(Element::__buf_)=" << logging::type<decltype(Element::__buf_)>());
+#endif
+    //////////////////////////////////////////////////////////////////////////////////////////////////
+    // static_assert(sizeof(F) < (3*sizeof(void*)), "lambda captures to be allocated on the heap"); //
+    //////////////////////////////////////////////////////////////////////////////////////////////////
+    return thread.exec(Element(std::allocator_arg, alloc, std::forward<F>(f)));
+  }
+  // Posts a forward range of closures with one synchronization and one wake-up; they are moved from.
+  template<class It> queue::Status dispatch_batch(It first, It last) {
+    return thread.exec_many(Wrap<It> {first, &alloc}, Wrap<It> {last, &alloc});
+  }
+  // Request/reply: runs f on the actor and returns a future of its result, which shares a single
+  // pooled allocation with the reply. Block on get(), or co_await it from a coroutine to hop onto
+  // this actor and back.
+  template<class F> future::Future<future::Result<F>> ask(F&& f) {
+    using R = future::Result<F>;
+    future::Promise<R> p;
+    future::Future<R> r = p.get_future();
+    dispatch(future::Ask<typename std::decay<F>::type, R>(std::forward<F>(f), std::move(p)));
+    return r;
+  }
+  // Timed dispatch, for executors with a timer wheel (Thread<>).
+  template<class F> timer::Handle exec_at(timer::Clock::time_point at, F&& f) {
+    return thread.exec_at(at, Element(std::allocator_arg, alloc, std::forward<F>(f)));
+  }
+  template<class F> timer::Handle exec_after(timer::Clock::duration delay, F&& f) {
+    return thread.exec_after(delay, Element(std::allocator_arg, alloc, std::forward<F>(f)));
+  }
+  template<class F> timer::Handle exec_every(timer::Clock::duration period, F&& f) {
+    return thread.exec_every(period, Element(std::allocator_arg, alloc, std::forward<F>(f)));
+  }
+};
+
+using Actor = BasicActor<Thread<>>;
+
+template<size_t N, class TSched = sched::Dedicated> struct Env {
+  template<class A> using up = std::unique_ptr<A>;
+  template<class A> using sp = std::shared_ptr<A>;
+  std::array<sp<Actor>, N> actors;
+  std::array<sp<Thread<>>, N> threads;
+  void init() {
+    initThreads();
+    initActors();
+  }
+  Actor& operator[] (size_t n) { return *actors[n]; }
+private:
+  void initThreads() {
+    for(auto& t: threads)
+      t.reset(new Thread<>);
+  }
+  void initActors() {
+    auto i = 0;
+    do {
+      threads[i]->exec([this, i](){
+          actors[i].reset(new Actor(*threads[i]));
+        });
+    } while (++i < N);
+  }
+};
+
+// N actors multiplexed on an M-worker work-stealing Executor.
+template<size_t N, size_t M> struct Env<N, sched::Stealing<M>> {
+  template<class A> using up = std::unique_ptr<A>;
+  template<class A> using sp = std::shared_ptr<A>;
+  using Actor = BasicActor<sched::Strand>;
+  std::array<sp<Actor>, N> actors;
+  std::array<sp<sched::Strand>, N> strands;
+  up<sched::Executor> executor; // declared last so its workers are joined first
+  void init() {
+    initStrands();
+    initActors();
+  }
+  Actor& operator[] (size_t n) { return *actors[n]; }
+private:
+  void initStrands() {
+    executor.reset(new sched::Executor(M));
+    for(auto& s: strands)
+      s.reset(new sched::Strand(*executor));
+  }
+  void initActors() {
+    auto i = 0;
+    do {
+      strands[i]->exec([this, i](){
+          actors[i].reset(new Actor(*strands[i]));
+        });
+    } while (++i < N);
+  }
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdlib>
+#include <cxxabi.h>
+#include <memory>
+#include <string>
+#include <typeinfo>
+
+namespace cpp {
+  inline std::string demangle(const char* name) {
+    int status = -4;
+    std::unique_ptr<char, void(*)(void*)> p {
+      abi::__cxa_demangle(name, nullptr, nullptr, &status),
+        std::free
+        };
+    return not status ? p.get() : name;
+  }
+
+  // Demangled on first use, then shared; never freed so the log flusher can read it during exit.
+  template<class T> const std::string& demangle() {
+    static const std::string* s = new std::string(demangle(typeid(T).name()));
+    return *s;
+  }
+} // namespace cpp
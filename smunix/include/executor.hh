@@ -0,0 +1,332 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional.H>
+#include <futex.hh>
+#include <future.hh>
+#include <queue.hh>
+
+// M worker threads running many actors. Each actor is a Strand: a lock-free mailbox that is
+// scheduled onto a worker when it receives its first pending message and stays scheduled until
+// it is drained, so one actor never runs on two workers at once and its messages run in order.
+namespace sched {
+  struct Dedicated {};                 // Env policy: one Thread<> per actor
+  template<size_t M> struct Stealing {}; // Env policy: N actors on an M-worker Executor
+
+  // Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli, PPoPP'13).
+  // The owner pushes and pops at the bottom, thieves steal from the top.
+  template<class T> class Deque {
+    struct Array {
+      explicit Array(int64_t size) : size(size), buf(new std::atomic<T>[size]) {}
+      T get(int64_t i) const { return buf[i & (size - 1)].load(std::memory_order_relaxed); }
+      void put(int64_t i, T x) { buf[i & (size - 1)].store(x, std::memory_order_relaxed); }
+      int64_t size;
+      std::unique_ptr<std::atomic<T>[]> buf;
+    };
+    // Padding rather than alignas(64): these objects are heap-allocated and C++11 new
+    // does not honour extended alignment.
+    char pad0[64];
+    std::atomic<int64_t> top {0};
+    char pad1[64];
+    std::atomic<int64_t> bottom {0};
+    char pad2[64];
+    std::atomic<Array*> array;
+    std::vector<std::unique_ptr<Array>> arrays; // grown arrays stay alive for late thieves
+  public:
+    explicit Deque(int64_t size = 256) {
+      arrays.emplace_back(new Array(size));
+      array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+    void push(T x) {
+      int64_t b = bottom.load(std::memory_order_relaxed);
+      int64_t t = top.load(std::memory_order_acquire);
+      Array* a = array.load(std::memory_order_relaxed);
+      if (b - t > a->size - 1) {
+        arrays.emplace_back(new Array(a->size * 2));
+        Array* g = arrays.back().get();
+        for (int64_t i = t; i < b; ++i)
+          g->put(i, a->get(i));
+        array.store(a = g, std::memory_order_release);
+      }
+      a->put(b, x);
+      std::atomic_thread_fence(std::memory_order_release);
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    T pop() {
+      int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+      Array* a = array.load(std::memory_order_relaxed);
+      bottom.store(b, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t t = top.load(std::memory_order_relaxed);
+      T x {};
+      if (t <= b) {
+        x = a->get(b);
+        if (t == b) {
+          if (not top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            x = T {};
+          bottom.store(b + 1, std::memory_order_relaxed);
+        }
+      } else
+        bottom.store(b + 1, std::memory_order_relaxed);
+      return x;
+    }
+    T steal() {
+      int64_t t = top.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      int64_t b = bottom.load(std::memory_order_acquire);
+      if (t >= b)
+        return T {};
+      Array* a = array.load(std::memory_order_acquire);
+      T x = a->get(t);
+      if (not top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return T {};
+      return x;
+    }
+    bool empty() const {
+      return bottom.load(std::memory_order_seq_cst) <= top.load(std::memory_order_seq_cst);
+    }
+  };
+
+  class Strand;
+
+  class Executor {
+    struct Worker {
+      Executor* executor;
+      Deque<Strand*> deque;
+      std::thread thread;
+      uint64_t seed;
+    };
+  public:
+    explicit Executor(size_t workers = std::max(1u, std::thread::hardware_concurrency()));
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+    ~Executor() { stop(); }
+    // Joins the workers; strands still scheduled are left with their messages unrun.
+    void stop();
+    bool stopped() const { return not running.load(std::memory_order_acquire); }
+    // Called with the strand marked scheduled. From one of our workers the strand goes to that
+    // worker's deque, otherwise (or when it yields after a full batch) to the shared FIFO.
+    // Closed, and the strand not queued, once stopped.
+    queue::Status submit(Strand* s, bool yield = false);
+  private:
+    Worker*& current() {
+      static thread_local Worker* w = nullptr;
+      return w;
+    }
+    Strand* inject() {
+      if (not injected.load(std::memory_order_seq_cst))
+        return nullptr;
+      std::unique_lock<std::mutex> l(m);
+      if (shared.empty())
+        return nullptr;
+      Strand* s = shared.front();
+      shared.pop_front();
+      injected.store(shared.size(), std::memory_order_seq_cst);
+      return s;
+    }
+    Strand* steal(Worker& w) {
+      w.seed ^= w.seed << 13; w.seed ^= w.seed >> 7; w.seed ^= w.seed << 17;
+      size_t n = workers.size();
+      for (size_t i = 0, v = w.seed % n; i < n; ++i, v = (v + 1) % n)
+        if (workers[v].get() != &w)
+          if (Strand* s = workers[v]->deque.steal())
+            return s;
+      return nullptr;
+    }
+    Strand* find(Worker& w) {
+      if (Strand* s = w.deque.pop())
+        return s;
+      if (Strand* s = inject())
+        return s;
+      return steal(w);
+    }
+    bool pending() const {
+      if (injected.load(std::memory_order_seq_cst))
+        return true;
+      for (auto& w: workers)
+        if (not w->deque.empty())
+          return true;
+      return false;
+    }
+    void park() {
+      uint32_t e = epoch.load(std::memory_order_seq_cst);
+      idle.fetch_add(1, std::memory_order_seq_cst);
+      if (running and not pending())
+        futex::wait(epoch, e);
+      idle.fetch_sub(1, std::memory_order_seq_cst);
+    }
+    void wake(bool all = false) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (all or idle.load(std::memory_order_seq_cst)) {
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+        futex::wake(epoch, all ? INT_MAX : 1);
+      }
+    }
+    void apply(Worker& w);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex m;
+    std::deque<Strand*> shared;
+    std::atomic<size_t> injected {0};
+    std::atomic<uint32_t> epoch {0};
+    std::atomic<uint32_t> idle {0};
+    std::atomic<bool> running {true};
+  };
+
+  // Serial mailbox on an Executor; same exec() surface as Thread<>.
+  // Destroying a strand waits for a worker still draining it to finish, so it may go before its
+  // executor; nothing may post to it meanwhile, and none of its own messages may destroy it.
+  class Strand {
+  public:
+    using Element = smunix::function<void(), 8>;
+    static constexpr size_t Batch = 64; // messages run before yielding the worker to other strands
+
+    explicit Strand(Executor& executor) : executor(executor) {}
+    Strand(const Strand&) = delete;
+    Strand& operator=(const Strand&) = delete;
+    ~Strand() {
+      while (refs.load(std::memory_order_acquire))
+        std::this_thread::yield();
+    }
+    // Closed once the executor has stopped.
+    template<class F> queue::Status exec(F&& f) {
+      if (executor.stopped()) return queue::Closed;
+      queue.push(std::forward<F>(f));
+      return schedule();
+    }
+    // Posts a forward range of closures, moving from them, with one CAS and one submission.
+    template<class It> queue::Status exec_many(It first, It last) {
+      if (executor.stopped()) return queue::Closed;
+      if (first == last) return queue::Accepted;
+      queue.push(first, last);
+      return schedule();
+    }
+    // Called by a worker with the reference submit() took, released as the very last step.
+    void run() {
+      struct Current {
+        Strand* s;
+        future::Executor* prev;
+        explicit Current(Strand* s) : s(s), prev(future::current()) {}
+        ~Current() {
+          future::current() = prev;
+          s->release(); // last touch of the strand
+        }
+      } c(this);
+      future::current() = &resumer;
+      size_t n = 0;
+      for (; n < Batch; ++n) {
+        try {
+          if (not queue.process())
+            break;
+        } catch(...) {
+        }
+      }
+      if (n == Batch) {
+        submit(true);
+        return;
+      }
+      // The batch is drained; once unscheduled another worker may own the consumer side,
+      // so only the producer end is looked at.
+      scheduled.store(false, std::memory_order_seq_cst);
+      if (queue.pushed() and not scheduled.exchange(true, std::memory_order_seq_cst))
+        submit();
+    }
+  private:
+    friend class Executor;
+
+    queue::Status schedule() {
+      if (scheduled.exchange(true, std::memory_order_seq_cst))
+        return queue::Accepted;
+      return submit();
+    }
+    queue::Status submit(bool yield = false) {
+      queue::Status s = executor.submit(this, yield);
+      if (s == queue::Closed)
+        abandon();
+      return s;
+    }
+    // Left unscheduled by a stopped executor; its messages stay queued, unrun.
+    void abandon() { scheduled.store(false, std::memory_order_seq_cst); }
+    void release() { refs.fetch_sub(1, std::memory_order_release); }
+    // Coroutines suspended on this strand resume through here.
+    static void resume(void* self, void* frame) {
+      static_cast<Strand*>(self)->exec(future::Resume(frame));
+    }
+    Executor& executor;
+    queue::Mpsc<Element> queue;
+    std::atomic<bool> scheduled {false};
+    // Held by the executor from each submission to the end of the run() it leads to, so one
+    // count covers queued and running alike; after a yield, two runs may overlap briefly.
+    std::atomic<uint32_t> refs {0};
+    future::Executor resumer {this, &Strand::resume};
+  };
+
+  inline Executor::Executor(size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      workers.emplace_back(new Worker);
+      workers.back()->executor = this;
+      workers.back()->seed = 0x9e3779b97f4a7c15ull * (i + 1);
+    }
+    for (auto& w: workers) {
+      Worker* p = w.get();
+      p->thread = std::thread([this, p]() { apply(*p); });
+    }
+  }
+
+  inline void Executor::stop() {
+    if (not running.exchange(false))
+      return;
+    wake(true);
+    for (auto& w: workers)
+      if (w->thread.joinable())
+        w->thread.join();
+    // The workers are gone: unschedule what they left, so those strands can be destroyed.
+    std::unique_lock<std::mutex> l(m);
+    for (auto& w: workers)
+      while (Strand* s = w->deque.pop()) {
+        s->abandon();
+        s->release();
+      }
+    for (Strand* s: shared) {
+      s->abandon();
+      s->release();
+    }
+    shared.clear();
+    injected.store(0, std::memory_order_seq_cst);
+  }
+
+  inline queue::Status Executor::submit(Strand* s, bool yield) {
+    Worker* w = current();
+    if (w and w->executor == this and not yield) {
+      s->refs.fetch_add(1, std::memory_order_relaxed);
+      w->deque.push(s); // stop() takes it back once this worker has been joined
+    } else {
+      std::unique_lock<std::mutex> l(m);
+      if (not running)
+        return queue::Closed;
+      s->refs.fetch_add(1, std::memory_order_relaxed);
+      shared.push_back(s);
+      injected.store(shared.size(), std::memory_order_seq_cst);
+    }
+    wake();
+    return queue::Accepted;
+  }
+
+  inline void Executor::apply(Worker& w) {
+    current() = &w;
+    while (running) {
+      if (Strand* s = find(w))
+        s->run();
+      else
+        park();
+    }
+    current() = nullptr;
+  }
+} // sched
@@ -1,6 +1,9 @@
 #pragma once
 #include <memory>
 #include <type_traits>
+#include <functional.H>
+#include <log.hh>
+#include <pool.hh>
 
 namespace func {
   namespace alloc {
@@ -9,18 +12,18 @@ namespace func {
       typedef T value_type;
       Custom() noexcept {}
       template <class U> Custom (const Custom<U>&) noexcept {
-        logtv(this);
+        log_trace(logging::type<decltype(this)>());
       }
       T* allocate (std::size_t n) {
-        auto r = static_cast<T*>(::operator new(n*sizeof(value_type)));
-        logtv(this);
-        log(r << ", " << n << ", " << n*sizeof(value_type));
+        auto r = static_cast<T*>(pool::allocate(n*sizeof(value_type)));
+        log_trace(logging::type<decltype(this)>());
+        log_trace(r << ", " << n << ", " << n*sizeof(value_type));
         return r;
       }
       void deallocate (T* p, std::size_t n) {
-        logtv(this);
-        log(p << ", " << n << ", " << n * sizeof(value_type));
-        ::operator delete(p);
+        log_trace(logging::type<decltype(this)>());
+        log_trace(p << ", " << n << ", " << n * sizeof(value_type));
+        pool::deallocate(p, n*sizeof(value_type));
       }
       template<class V> struct rebind {
         using other = Custom<V>;
@@ -38,36 +41,37 @@ namespace func {
 } // func
 
 namespace func {
+  // std::function lost its allocator-aware constructors; smunix::function keeps them.
+  template<class T> using function = smunix::function<T>;
 
   template<class F> struct Size {
     static constexpr size_t apply() { return sizeof(F); }
   };
 
+  // One allocator per thread and closure size; blocks come from that thread's pool cache.
   template<size_t N> struct Allocator {
     template<class Ap> static Ap& apply() {
-      __thread static Ap* g_ap;
-      if (not g_ap)
-        g_ap = new Ap;
-      logtv(g_ap);
-      log(g_ap << ", size=" << N);
-      return *g_ap;
+      static thread_local Ap g_ap;
+      log_trace(logging::type<decltype(&g_ap)>());
+      log_trace(&g_ap << ", size=" << N);
+      return g_ap;
     }
   };
 
   template<class T> struct Make {
-    template<class F> static auto apply() -> std::function<T> { return std::function<T>{}; }
-    template<class F> static auto apply(F&& f) -> std::function<T> {
-      return std::function<T>(std::allocator_arg, Allocator<Size<typename std::decay<F>::type>::apply()>::template apply<alloc::Custom<int>>(), std::forward<F>(f));
+    static auto apply() -> function<T> { return function<T>{}; }
+    template<class F> static auto apply(F&& f) -> function<T> {
+      return function<T>(std::allocator_arg, Allocator<Size<typename std::decay<F>::type>::apply()>::template apply<alloc::Custom<int>>(), std::forward<F>(f));
     }
   };
-  template<class T, class F> auto make(F&& f) -> std::function<T> {
+  template<class T, class F> auto make(F&& f) -> function<T> {
     return Make<T>::template apply(std::forward<F>(f));
   }
-  template<class T> auto make() -> std::function<T> {
+  template<class T> auto make() -> function<T> {
     return Make<T>::template apply();
   }
   template<class F> struct Assign;
-  template<class T> struct Assign<std::function<T>> {
+  template<class T> struct Assign<function<T>> {
     template<class F, class NF> static auto apply(F&& f, NF&& nf) -> void {
       std::forward<F>(f).assign(std::forward<NF>(nf), Allocator<Size<typename std::decay<NF>::type>::apply()>::template apply<alloc::Custom<int>>());
     }
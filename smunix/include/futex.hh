@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Thin wrappers over the Linux futex syscall, used to park a consumer only once its queue is empty.
+namespace futex {
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be a plain 32-bit integer");
+
+  inline uint32_t* word(std::atomic<uint32_t>& w) { return reinterpret_cast<uint32_t*>(&w); }
+
+  // Sleeps while w == v; returns on wake-up, on signal, or at once if w != v.
+  inline void wait(std::atomic<uint32_t>& w, uint32_t v) {
+    syscall(SYS_futex, word(w), FUTEX_WAIT_PRIVATE, v, nullptr, nullptr, 0);
+  }
+
+  // Same, giving up after `timeout`.
+  inline void wait(std::atomic<uint32_t>& w, uint32_t v, std::chrono::nanoseconds timeout) {
+    if (timeout.count() <= 0)
+      return;
+    timespec ts;
+    ts.tv_sec = time_t(timeout.count() / 1000000000);
+    ts.tv_nsec = long(timeout.count() % 1000000000);
+    syscall(SYS_futex, word(w), FUTEX_WAIT_PRIVATE, v, &ts, nullptr, 0);
+  }
+
+  inline void wake(std::atomic<uint32_t>& w, int n = 1) {
+    syscall(SYS_futex, word(w), FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+  }
+} // futex
@@ -0,0 +1,264 @@
+#pragma once
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <futex.hh>
+#include <pool.hh>
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L && __has_include(<coroutine>)
+#include <coroutine>
+#define SMUNIX_COROUTINES 1
+#else
+#define SMUNIX_COROUTINES 0
+#endif
+
+// Request/reply between actors. A Promise and its Future share one State taken from the per-thread
+// pool; its status word is both the futex a blocking get() sleeps on and the handshake with a
+// coroutine awaiting the Future, so a reply costs that single allocation and no lock.
+//
+// In C++20 a Future is awaitable, and a coroutine returning Future<T> allocates its frame from the
+// pool too. An awaiting coroutine resumes through the executor that was running it (Thread<> and
+// Strand register themselves as current()), so it continues on its own actor once the reply is
+// set; awaited from any other thread, it resumes inline on the thread that sets the reply.
+// The executor must outlive the coroutines suspended on it: a resumption posted to an executor that
+// has stopped is dropped, destroying the coroutine frame.
+namespace future {
+  template<class T> class Promise;
+  template<class T> class Future;
+
+  // The executor running the current message.
+  struct Executor {
+    void* self;
+    void (*post)(void* self, void* frame); // posts a Resume of the frame
+  };
+
+  inline Executor*& current() {
+    static thread_local Executor* e = nullptr;
+    return e;
+  }
+
+  namespace details {
+    enum : uint32_t { Empty, Sleeping, Armed, Ready };
+
+    struct Unit {};
+    template<class T> using Value = typename std::conditional<std::is_void<T>::value, Unit, T>::type;
+
+    template<class T> struct State {
+      static void* operator new(size_t n) { return pool::allocate(n); }
+      static void operator delete(void* p, size_t n) { pool::deallocate(p, n); }
+      using V = Value<T>;
+
+      State() {}
+      ~State() {
+        if (has_value)
+          value.~V();
+      }
+      void release() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+          delete this;
+      }
+
+      std::atomic<uint32_t> status {Empty};
+      std::atomic<int> refs {1};
+      Executor* executor = nullptr; // where the awaiting coroutine resumes
+      void* frame = nullptr;        // the awaiting coroutine
+      std::exception_ptr error;
+      bool has_value = false;
+      union { V value; };
+    };
+
+    inline void resume(void* frame) {
+#if SMUNIX_COROUTINES
+      std::coroutine_handle<>::from_address(frame).resume();
+#else
+      (void)frame;
+#endif
+    }
+    inline void destroy(void* frame) {
+#if SMUNIX_COROUTINES
+      std::coroutine_handle<>::from_address(frame).destroy();
+#else
+      (void)frame;
+#endif
+    }
+
+    template<class T> struct Call;
+  } // details
+
+  // Resumes a suspended coroutine when run; destroys it if dropped unrun.
+  class Resume {
+    void* frame;
+  public:
+    explicit Resume(void* frame) : frame(frame) {}
+    Resume(Resume&& o) noexcept : frame(o.frame) { o.frame = nullptr; }
+    ~Resume() {
+      if (frame)
+        details::destroy(frame);
+    }
+    void operator()() {
+      void* f = frame;
+      frame = nullptr;
+      details::resume(f);
+    }
+  };
+
+  // The producer side; dropping it unset stores a broken_promise std::future_error.
+  template<class T> class Promise {
+    using State = details::State<T>;
+    State* s;
+
+    void publish() {
+      State* p = s;
+      s = nullptr;
+      uint32_t prev = p->status.exchange(details::Ready, std::memory_order_acq_rel);
+      if (prev == details::Sleeping)
+        futex::wake(p->status, INT_MAX);
+      else if (prev == details::Armed) {
+        if (p->executor)
+          p->executor->post(p->executor->self, p->frame);
+        else
+          details::resume(p->frame);
+      }
+      p->release();
+    }
+  public:
+    Promise() : s(new State) {}
+    Promise(Promise&& o) noexcept : s(o.s) { o.s = nullptr; }
+    Promise& operator=(Promise&& o) noexcept {
+      std::swap(s, o.s);
+      return *this;
+    }
+    ~Promise() {
+      if (s)
+        set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+    }
+    // Once, before the value is set.
+    Future<T> get_future() {
+      s->refs.fetch_add(1, std::memory_order_relaxed);
+      return Future<T>(s);
+    }
+    template<class... A> void set_value(A&&... a) {
+      ::new (static_cast<void*>(&s->value)) typename State::V(std::forward<A>(a)...);
+      s->has_value = true;
+      publish();
+    }
+    void set_exception(std::exception_ptr e) {
+      s->error = std::move(e);
+      publish();
+    }
+    // Sets the result of f(), or the exception it threw.
+    template<class F> void apply(F& f) {
+      std::exception_ptr e;
+      try {
+        details::Call<T>::apply(*this, f);
+      } catch(...) {
+        e = std::current_exception();
+      }
+      if (e)
+        set_exception(std::move(e));
+    }
+  };
+
+  namespace details {
+    template<class T> struct Call {
+      template<class F> static void apply(Promise<T>& p, F& f) { p.set_value(f()); }
+      static T get(State<T>* s) { return std::move(s->value); }
+    };
+    template<> struct Call<void> {
+      template<class F> static void apply(Promise<void>& p, F& f) {
+        f();
+        p.set_value();
+      }
+      static void get(State<void>*) {}
+    };
+  } // details
+
+  // The consumer side, for one thread: either get() it or co_await it.
+  template<class T> class Future {
+    using State = details::State<T>;
+    State* s = nullptr;
+  public:
+    Future() = default;
+    explicit Future(State* s) : s(s) {}
+    Future(Future&& o) noexcept : s(o.s) { o.s = nullptr; }
+    Future& operator=(Future&& o) noexcept {
+      std::swap(s, o.s);
+      return *this;
+    }
+    ~Future() {
+      if (s)
+        s->release();
+    }
+    bool valid() const { return s; }
+    bool ready() const { return s->status.load(std::memory_order_acquire) == details::Ready; }
+    void wait() const {
+      uint32_t st = details::Empty;
+      if (s->status.compare_exchange_strong(st, details::Sleeping, std::memory_order_acq_rel, std::memory_order_acquire))
+        st = details::Sleeping;
+      while (st != details::Ready) {
+        futex::wait(s->status, details::Sleeping);
+        st = s->status.load(std::memory_order_acquire);
+      }
+    }
+    // Waits for the reply and takes it, rethrowing a stored exception; the future is then invalid.
+    T get() {
+      wait();
+      struct Guard { State* s; ~Guard() { s->release(); } } g {s};
+      s = nullptr;
+      if (g.s->error)
+        std::rethrow_exception(g.s->error);
+      return details::Call<T>::get(g.s);
+    }
+#if SMUNIX_COROUTINES
+    bool await_ready() const noexcept { return ready(); }
+    bool await_suspend(std::coroutine_handle<> h) {
+      s->executor = current();
+      s->frame = h.address();
+      uint32_t st = details::Empty;
+      return s->status.compare_exchange_strong(st, details::Armed, std::memory_order_acq_rel, std::memory_order_acquire);
+    }
+    T await_resume() { return get(); }
+
+    struct promise_type;
+#endif
+  };
+
+  template<class F> using Result = typename std::decay<decltype(std::declval<typename std::decay<F>::type&>()())>::type;
+
+  // The message posted by ask(): runs F and replies through the promise.
+  template<class F, class R> struct Ask {
+    template<class G> Ask(G&& f, Promise<R>&& promise) : f(std::forward<G>(f)), promise(std::move(promise)) {}
+    void operator()() { promise.apply(f); }
+    F f;
+    Promise<R> promise;
+  };
+
+#if SMUNIX_COROUTINES
+  namespace details {
+    template<class T> struct Returns {
+      Promise<T> promise;
+      template<class U> void return_value(U&& v) { promise.set_value(std::forward<U>(v)); }
+    };
+    template<> struct Returns<void> {
+      Promise<void> promise;
+      void return_void() { promise.set_value(); }
+    };
+  } // details
+
+  // A coroutine returning Future<T> starts at once and runs to its first suspension; its result
+  // or exception goes to the future.
+  template<class T> struct Future<T>::promise_type : details::Returns<T> {
+    static void* operator new(size_t n) { return pool::allocate(n); }
+    static void operator delete(void* p, size_t n) { pool::deallocate(p, n); }
+
+    Future get_return_object() { return this->promise.get_future(); }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void unhandled_exception() { this->promise.set_exception(std::current_exception()); }
+  };
+#endif
+} // future
@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+// How a Thread<> dispatcher idles once its queue is empty. Each strategy provides
+//   template<class Q> void wait(Q& queue, const std::atomic<bool>& running, Clock::time_point deadline);
+// which returns when the queue may hold work, running dropped, or the deadline (the next timer,
+// Clock::time_point::max() if none) passed. Spurious returns are fine: the caller polls again.
+// Only Block and Adaptive ever sleep in the kernel; the others keep their core busy and suit a
+// dispatcher pinned to a CPU of its own.
+namespace idle {
+  using Clock = std::chrono::steady_clock;
+
+  inline void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+
+  namespace details {
+    // Clock reads are amortized over this many polls when a deadline is set.
+    constexpr unsigned Poll = 64;
+
+    inline bool due(Clock::time_point deadline, unsigned i) {
+      return deadline != Clock::time_point::max() and i % Poll == 0 and Clock::now() >= deadline;
+    }
+  } // details
+
+  // Sleeps on the queue's condition variable or futex; the producer's push wakes it.
+  struct Block {
+    template<class Q> void wait(Q& queue, const std::atomic<bool>& running, Clock::time_point deadline) {
+      queue.wait_until(running, deadline);
+    }
+  };
+
+  // Polls the queue without ever giving up the CPU.
+  struct Spin {
+    template<class Q> void wait(Q& queue, const std::atomic<bool>& running, Clock::time_point deadline) {
+      for (unsigned i = 1; running and queue.empty() and not details::due(deadline, i); ++i)
+        pause();
+    }
+  };
+
+  // Polls for Spins rounds, then yields the CPU between polls.
+  template<unsigned Spins = 1024> struct SpinYield {
+    template<class Q> void wait(Q& queue, const std::atomic<bool>& running, Clock::time_point deadline) {
+      for (unsigned i = 1; running and queue.empty() and not details::due(deadline, i); ++i)
+        if (i < Spins)
+          pause();
+        else
+          std::this_thread::yield();
+    }
+  };
+
+  // Polls, then sleeps as Block does. The polling budget follows recent history: it grows
+  // toward twice the polls that last found work and shrinks each time polling was in vain.
+  template<unsigned MinSpins = 64, unsigned MaxSpins = 1 << 14> struct Adaptive {
+    unsigned spins = MinSpins;
+
+    template<class Q> void wait(Q& queue, const std::atomic<bool>& running, Clock::time_point deadline) {
+      for (unsigned i = 1; i <= spins; ++i) {
+        if (not running or details::due(deadline, i))
+          return;
+        if (not queue.empty()) {
+          long s = long(spins) + (2 * long(i) - long(spins)) / 8;
+          spins = unsigned(std::min<long>(MaxSpins, std::max<long>(MinSpins, s)));
+          return;
+        }
+        pause();
+      }
+      spins = std::max(MinSpins, spins - spins / 8);
+      queue.wait_until(running, deadline);
+    }
+  };
+} // idle
@@ -0,0 +1,360 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <demangle.hh>
+
+// Asynchronous binary logger.
+// Every log site is a static Site whose address is the record's format id. The logging thread
+// appends that id, a timestamp and the raw arguments to its own single-producer ring and returns;
+// a background thread decodes the records of all rings, merged by timestamp, and prints them as
+// the former mutex + std::cout Logger did: "tid=<id>:line=<L>, func=<F>, <arguments>".
+// A record that does not fit is dropped and counted, so a producer never blocks on the output.
+// Sites below SMUNIX_LOG_LEVEL are compiled out; the library's own per-message sites (dispatch,
+// allocator hooks) log at trace level, so the default level keeps them off the hot path.
+#define SMUNIX_LOG_TRACE 0
+#define SMUNIX_LOG_DEBUG 1
+#define SMUNIX_LOG_INFO 2
+#define SMUNIX_LOG_WARN 3
+#define SMUNIX_LOG_ERROR 4
+#define SMUNIX_LOG_OFF 5
+
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_DEBUG
+#endif
+
+namespace logging {
+  struct Site {
+    int level;
+    int line;
+    const char* func;
+  };
+
+  // Logged as a pointer to the cached demangled name instead of a copy of it.
+  struct Name {
+    const std::string* s;
+  };
+
+  template<class T> Name type() { return Name {&cpp::demangle<T>()}; }
+
+  namespace details {
+    enum Tag : uint8_t { Bool, Char, Int, UInt, Float, Ptr, Str, Type, Manip, Stream };
+
+    struct Header {
+      const Site* site;
+      int64_t ticks;
+      uint32_t size; // header included
+    };
+
+    inline int64_t ticks() { return std::chrono::steady_clock::now().time_since_epoch().count(); }
+
+    // Single producer (the owning thread), single consumer (whoever holds Flusher::d).
+    struct Ring {
+      static constexpr uint64_t Capacity = 1 << 18;
+      static constexpr size_t MaxString = 1 << 10; // longer string arguments are truncated
+
+      Ring() : buf(new char[Capacity]), id(std::this_thread::get_id()) {}
+      void write(uint64_t pos, const void* p, size_t n) {
+        size_t i = pos & (Capacity - 1), k = std::min<size_t>(n, Capacity - i);
+        std::memcpy(&buf[i], p, k);
+        std::memcpy(&buf[0], static_cast<const char*>(p) + k, n - k);
+      }
+      void read(uint64_t pos, void* p, size_t n) const {
+        size_t i = pos & (Capacity - 1), k = std::min<size_t>(n, Capacity - i);
+        std::memcpy(p, &buf[i], k);
+        std::memcpy(static_cast<char*>(p) + k, &buf[0], n - k);
+      }
+
+      char pad0[64];
+      std::atomic<uint64_t> head {0};    // consumer
+      char pad1[64];
+      std::atomic<uint64_t> tail {0};    // producer
+      std::atomic<uint64_t> dropped {0}; // producer
+      std::atomic<bool> closed {false};  // set once the owning thread has exited
+      char pad2[64];
+      uint64_t reported = 0;             // consumer: drops already printed
+      std::unique_ptr<char[]> buf;
+      std::thread::id id;
+    };
+
+    class Flusher {
+    public:
+      Flusher() : out(&std::cout), thread([this]() { apply(); }) {}
+      void add(Ring* r) {
+        std::unique_lock<std::mutex> l(m);
+        rings.push_back(r);
+      }
+      void sink(std::ostream& os) {
+        std::unique_lock<std::mutex> l(d);
+        out = &os;
+      }
+      void stop() {
+        {
+          std::unique_lock<std::mutex> l(m);
+          if (not running)
+            return;
+          running = false;
+        }
+        cv.notify_one();
+        thread.join();
+        drain();
+      }
+      // Prints every committed record, oldest first across rings.
+      void drain();
+    private:
+      struct Cursor {
+        Ring* ring;
+        uint64_t pos, end;
+        bool closed;
+        Header header;
+      };
+      void apply() {
+        std::unique_lock<std::mutex> l(m);
+        while (running) {
+          cv.wait_for(l, std::chrono::milliseconds(1));
+          l.unlock();
+          drain();
+          l.lock();
+        }
+      }
+      void print(Cursor& c);
+
+      std::mutex m;
+      std::condition_variable cv;
+      std::vector<Ring*> rings;
+      bool running = true;
+      std::mutex d; // serializes consumers
+      std::ostream* out;
+      std::ostringstream os;
+      const std::ios clean {nullptr}; // default format flags, restored before each record
+      std::thread thread;
+    };
+
+    // The flusher is never freed: a thread still logging during exit writes into its ring and is
+    // simply not printed once the final drain has run.
+    inline Flusher& flusher() {
+      struct Shutdown {
+        Flusher* f = new Flusher;
+        ~Shutdown() { f->stop(); }
+      };
+      static Shutdown s;
+      return *s.f;
+    }
+
+    struct Owner {
+      Ring* ring = new Ring;
+      Owner() { flusher().add(ring); }
+      ~Owner() { ring->closed.store(true, std::memory_order_release); }
+    };
+
+    inline Ring& local() {
+      static thread_local Owner o;
+      return *o.ring;
+    }
+
+    template<class T, class = void> struct Arg;
+
+    class Record {
+    public:
+      explicit Record(const Site* site) : ring(local()), site(site), pos(ring.tail.load(std::memory_order_relaxed)) {
+        room = Ring::Capacity - (pos - ring.head.load(std::memory_order_acquire));
+        ok = off <= room;
+      }
+      Record(const Record&) = delete;
+      Record& operator=(const Record&) = delete;
+      ~Record() {
+        if (not ok) {
+          ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+          return;
+        }
+        Header h {site, ticks(), uint32_t(off)};
+        ring.write(pos, &h, sizeof(h));
+        ring.tail.store(pos + off, std::memory_order_release);
+      }
+      // Scalars by value, so a constant such as a local constexpr is not odr-used (as with std::ostream).
+      template<class T> typename std::enable_if<std::is_scalar<T>::value, Record&>::type operator<<(T v) {
+        Arg<T>::put(*this, v);
+        return *this;
+      }
+      template<class T> typename std::enable_if<not std::is_scalar<typename std::decay<T>::type>::value, Record&>::type operator<<(const T& v) {
+        Arg<T>::put(*this, v);
+        return *this;
+      }
+      Record& operator<<(std::ios_base& (*m)(std::ios_base&)) { return raw(Manip, m); }
+      Record& operator<<(std::ostream& (*m)(std::ostream&)) { return raw(Stream, m); }
+
+      template<class T> Record& raw(Tag t, const T& v) {
+        if (reserve(1 + sizeof(T))) {
+          ring.write(pos + off, &t, 1);
+          ring.write(pos + off + 1, &v, sizeof(T));
+          off += 1 + sizeof(T);
+        }
+        return *this;
+      }
+      Record& str(const char* s, size_t n) {
+        uint32_t k = uint32_t(std::min(n, size_t(Ring::MaxString)));
+        if (reserve(1 + sizeof(k) + k)) {
+          Tag t = Str;
+          ring.write(pos + off, &t, 1);
+          ring.write(pos + off + 1, &k, sizeof(k));
+          ring.write(pos + off + 1 + sizeof(k), s, k);
+          off += 1 + sizeof(k) + k;
+        }
+        return *this;
+      }
+    private:
+      bool reserve(size_t n) { return ok = ok and off + n <= room; }
+
+      Ring& ring;
+      const Site* site;
+      uint64_t pos;
+      uint64_t off = sizeof(Header);
+      uint64_t room;
+      bool ok;
+    };
+
+    // Anything without a raw encoding is formatted on the spot.
+    template<class T, class> struct Arg {
+      static void put(Record& r, const T& v) {
+        std::ostringstream os;
+        os << v;
+        const std::string& s = os.str();
+        r.str(s.data(), s.size());
+      }
+    };
+    template<> struct Arg<bool> {
+      static void put(Record& r, bool v) { r.raw(Bool, v); }
+    };
+    template<class T> struct Arg<T, typename std::enable_if<std::is_same<T, char>::value or std::is_same<T, signed char>::value or std::is_same<T, unsigned char>::value>::type> {
+      static void put(Record& r, T v) { r.raw(Char, char(v)); }
+    };
+    template<class T> struct Arg<T, typename std::enable_if<std::is_integral<T>::value and (sizeof(T) > 1) and std::is_signed<T>::value>::type> {
+      static void put(Record& r, T v) { r.raw(Int, int64_t(v)); }
+    };
+    template<class T> struct Arg<T, typename std::enable_if<std::is_integral<T>::value and (sizeof(T) > 1) and std::is_unsigned<T>::value>::type> {
+      static void put(Record& r, T v) { r.raw(UInt, uint64_t(v)); }
+    };
+    template<class T> struct Arg<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+      static void put(Record& r, T v) { r.raw(Float, double(v)); }
+    };
+    template<class T> struct Arg<T*, typename std::enable_if<not std::is_function<T>::value and not std::is_same<typename std::remove_cv<T>::type, char>::value>::type> {
+      static void put(Record& r, T* v) { r.raw(Ptr, static_cast<const volatile void*>(v)); }
+    };
+    template<class T> struct Arg<T*, typename std::enable_if<std::is_same<typename std::remove_cv<T>::type, char>::value>::type> {
+      static void put(Record& r, const char* v) { r.str(v, std::strlen(v)); }
+    };
+    template<> struct Arg<std::string> {
+      static void put(Record& r, const std::string& v) { r.str(v.data(), v.size()); }
+    };
+    template<> struct Arg<Name> {
+      static void put(Record& r, Name v) { r.raw(Type, v.s); }
+    };
+
+    inline void Flusher::print(Cursor& c) {
+      Ring& r = *c.ring;
+      os.str(std::string());
+      os.clear();
+      os.copyfmt(clean);
+      uint64_t p = c.pos + sizeof(Header), e = c.pos + c.header.size;
+      while (p < e) {
+        Tag t;
+        r.read(p++, &t, 1);
+        switch (t) {
+        case Bool: { bool v; r.read(p, &v, sizeof(v)); p += sizeof(v); os << v; break; }
+        case Char: { char v; r.read(p, &v, sizeof(v)); p += sizeof(v); os << v; break; }
+        case Int: { int64_t v; r.read(p, &v, sizeof(v)); p += sizeof(v); os << v; break; }
+        case UInt: { uint64_t v; r.read(p, &v, sizeof(v)); p += sizeof(v); os << v; break; }
+        case Float: { double v; r.read(p, &v, sizeof(v)); p += sizeof(v); os << v; break; }
+        case Ptr: { const volatile void* v; r.read(p, &v, sizeof(v)); p += sizeof(v); os << const_cast<const void*>(v); break; }
+        case Type: { const std::string* v; r.read(p, &v, sizeof(v)); p += sizeof(v); os << *v; break; }
+        case Manip: { std::ios_base& (*v)(std::ios_base&); r.read(p, &v, sizeof(v)); p += sizeof(v); os << v; break; }
+        case Stream: { std::ostream& (*v)(std::ostream&); r.read(p, &v, sizeof(v)); p += sizeof(v); os << v; break; }
+        case Str: {
+          uint32_t k;
+          r.read(p, &k, sizeof(k));
+          p += sizeof(k);
+          char s[Ring::MaxString];
+          r.read(p, s, k);
+          p += k;
+          os.write(s, k);
+          break;
+        }
+        }
+      }
+      *out << "tid=" << r.id << ":line=<" << c.header.site->line << ">, func=" << c.header.site->func << ", " << os.str() << '\n';
+    }
+
+    inline void Flusher::drain() {
+      std::unique_lock<std::mutex> l(d);
+      std::vector<Cursor> cs;
+      {
+        std::unique_lock<std::mutex> g(m);
+        for (Ring* r: rings) {
+          bool closed = r->closed.load(std::memory_order_acquire); // before tail: the last record is seen
+          cs.push_back(Cursor {r, r->head.load(std::memory_order_relaxed), r->tail.load(std::memory_order_acquire), closed, Header()});
+        }
+      }
+      for (Cursor& c: cs)
+        if (c.pos != c.end)
+          c.ring->read(c.pos, &c.header, sizeof(Header));
+      for (;;) {
+        Cursor* next = nullptr;
+        for (Cursor& c: cs)
+          if (c.pos != c.end and (not next or c.header.ticks < next->header.ticks))
+            next = &c;
+        if (not next)
+          break;
+        print(*next);
+        next->pos += next->header.size;
+        next->ring->head.store(next->pos, std::memory_order_release);
+        if (next->pos != next->end)
+          next->ring->read(next->pos, &next->header, sizeof(Header));
+      }
+      for (Cursor& c: cs) {
+        uint64_t n = c.ring->dropped.load(std::memory_order_relaxed);
+        if (n != c.ring->reported) {
+          *out << "tid=" << c.ring->id << ": dropped " << n - c.ring->reported << " records\n";
+          c.ring->reported = n;
+        }
+      }
+      out->flush();
+      std::unique_lock<std::mutex> g(m);
+      for (Cursor& c: cs)
+        if (c.closed) {
+          rings.erase(std::find(rings.begin(), rings.end(), c.ring));
+          delete c.ring;
+        }
+    }
+  } // details
+
+  // Prints, on the calling thread, every record committed so far.
+  inline void flush() { details::flusher().drain(); }
+
+  // Redirects the output; std::cout by default.
+  inline void sink(std::ostream& os) { details::flusher().sink(os); }
+} // logging
+
+#define SMUNIX_LOG(level, x) do {                                       \
+    if (level >= SMUNIX_LOG_LEVEL) {                                    \
+      static const logging::Site site_ {level, __LINE__, __PRETTY_FUNCTION__}; \
+      logging::details::Record {&site_} << x;                           \
+    }                                                                   \
+  } while(0)
+
+#define log_trace(x) SMUNIX_LOG(SMUNIX_LOG_TRACE, x)
+#define log_debug(x) SMUNIX_LOG(SMUNIX_LOG_DEBUG, x)
+#define log_info(x) SMUNIX_LOG(SMUNIX_LOG_INFO, x)
+#define log_warn(x) SMUNIX_LOG(SMUNIX_LOG_WARN, x)
+#define log_error(x) SMUNIX_LOG(SMUNIX_LOG_ERROR, x)
+
@@ -0,0 +1,177 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Per-thread size-class pool for closures spilled out of their small buffer.
+// Each thread owns a cache of free lists, one per power-of-two class from 16 to 4096 bytes,
+// carved out of 64 KiB slabs. A slab is aligned on its size and starts with a pointer to its
+// owning cache, so a block freed on another thread (allocated by a producer, destroyed by the
+// Thread<> consumer) is pushed onto the owner's lock-free remote list and picked up the next
+// time the owner runs dry. Slabs are never returned to the system; the cache of an exited
+// thread is adopted by the next thread that starts allocating.
+namespace pool {
+  constexpr size_t MinShift = 4;
+  constexpr size_t Classes = 9;
+  constexpr size_t MaxSize = size_t(1) << (MinShift + Classes - 1);
+  constexpr size_t Slab = 64 * 1024;
+  constexpr size_t SlabHeader = 64;
+
+  struct Stats {
+    uint64_t allocations = 0;   // blocks handed out by the pool
+    uint64_t deallocations = 0; // blocks returned by their owning thread
+    uint64_t remote = 0;        // blocks returned by another thread
+    uint64_t refills = 0;       // slabs taken from the system
+    uint64_t large = 0;         // requests above MaxSize, passed to ::operator new
+    uint64_t bytes = 0;         // slab bytes reserved
+  };
+
+  namespace details {
+    struct Node { Node* next; };
+
+    // Counters are only written by the owning thread; atomics keep stats() readers race-free.
+    struct Counter {
+      std::atomic<uint64_t> v {0};
+      void operator+=(uint64_t n) { v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+      uint64_t load() const { return v.load(std::memory_order_relaxed); }
+    };
+
+    struct Cache {
+      Node* free[Classes] = {};
+      char pad0[64];
+      std::atomic<Node*> remote[Classes];
+      char pad1[64];
+      Counter allocations, deallocations, remote_frees, refills, large, bytes;
+
+      Cache() {
+        for (auto& r: remote)
+          r.store(nullptr, std::memory_order_relaxed);
+      }
+      Node* refill(size_t cls) {
+        if (Node* n = remote[cls].exchange(nullptr, std::memory_order_acquire))
+          return n;
+        void* p = nullptr;
+        if (posix_memalign(&p, Slab, Slab))
+          throw std::bad_alloc();
+        *static_cast<Cache**>(p) = this;
+        size_t size = size_t(1) << (cls + MinShift);
+        char* b = static_cast<char*>(p) + SlabHeader;
+        char* e = static_cast<char*>(p) + Slab;
+        Node* head = nullptr;
+        for (char* q = e - size; q >= b; q -= size) {
+          Node* n = reinterpret_cast<Node*>(q);
+          n->next = head;
+          head = n;
+        }
+        refills += 1;
+        bytes += Slab;
+        return head;
+      }
+    };
+
+    struct Registry {
+      std::mutex m;
+      std::vector<Cache*> all;
+      std::vector<Cache*> orphans;
+    };
+
+    inline Registry& registry() {
+      static Registry* r = new Registry; // outlives every thread-local cache
+      return *r;
+    }
+
+    inline Cache* adopt() {
+      Registry& r = registry();
+      std::unique_lock<std::mutex> l(r.m);
+      if (not r.orphans.empty()) {
+        Cache* c = r.orphans.back();
+        r.orphans.pop_back();
+        return c;
+      }
+      r.all.push_back(new Cache);
+      return r.all.back();
+    }
+
+    inline void abandon(Cache* c) {
+      Registry& r = registry();
+      std::unique_lock<std::mutex> l(r.m);
+      r.orphans.push_back(c);
+    }
+
+    struct Owner {
+      Cache* cache = adopt();
+      ~Owner() { abandon(cache); }
+    };
+
+    inline Cache& local() {
+      static thread_local Owner o;
+      return *o.cache;
+    }
+
+    inline size_t index(size_t n) {
+      return n <= (size_t(1) << MinShift) ? 0 : (sizeof(unsigned long long) * 8 - __builtin_clzll(n - 1)) - MinShift;
+    }
+
+    inline Cache* owner(void* p) {
+      return *reinterpret_cast<Cache**>(reinterpret_cast<uintptr_t>(p) & ~(Slab - 1));
+    }
+  } // details
+
+  inline void* allocate(size_t n) {
+    details::Cache& c = details::local();
+    if (n > MaxSize) {
+      c.large += 1;
+      return ::operator new(n);
+    }
+    size_t cls = details::index(n);
+    details::Node* b = c.free[cls];
+    if (not b)
+      b = c.refill(cls);
+    c.free[cls] = b->next;
+    c.allocations += 1;
+    return b;
+  }
+
+  // n must be the size given to allocate().
+  inline void deallocate(void* p, size_t n) noexcept {
+    if (n > MaxSize) {
+      ::operator delete(p);
+      return;
+    }
+    size_t cls = details::index(n);
+    details::Node* b = static_cast<details::Node*>(p);
+    details::Cache& c = details::local();
+    details::Cache* o = details::owner(p);
+    if (o == &c) {
+      b->next = c.free[cls];
+      c.free[cls] = b;
+      c.deallocations += 1;
+      return;
+    }
+    details::Node* h = o->remote[cls].load(std::memory_order_relaxed);
+    do {
+      b->next = h;
+    } while (not o->remote[cls].compare_exchange_weak(h, b, std::memory_order_release, std::memory_order_relaxed));
+    c.remote_frees += 1;
+  }
+
+  // Sum over every cache, live or orphaned.
+  inline Stats stats() {
+    Stats s;
+    details::Registry& r = details::registry();
+    std::unique_lock<std::mutex> l(r.m);
+    for (details::Cache* c: r.all) {
+      s.allocations += c->allocations.load();
+      s.deallocations += c->deallocations.load();
+      s.remote += c->remote_frees.load();
+      s.refills += c->refills.load();
+      s.large += c->large.load();
+      s.bytes += c->bytes.load();
+    }
+    return s;
+  }
+} // pool
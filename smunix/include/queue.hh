@@ -0,0 +1,631 @@
+#pragma once
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <futex.hh>
+#include <pool.hh>
+#include <stats.hh>
+
+// Mailbox queues for Thread<>. Any number of threads push, a single consumer runs entries:
+//   template<class F> Pushed push(F&&, stats::Stamp = 0);  store F and wake the consumer
+//   template<class It> Pushed push(It, It, stats::Stamp = 0);  store a forward range, moving from
+//                                               it, with one synchronization and one wake-up;
+//                                               the stamp goes to the first entry
+//   template<class F> Pushed force(F&&, stats::Stamp = 0);  push past a bounded queue's capacity,
+//                                               never dropped; for the consumer's own messages
+//   template<class P> bool process(P&& probe);  run the oldest entry after probe(its stamp),
+//                                               false if none; consumer only
+//   bool process();                             same without a probe
+//   bool empty() const;                         nothing to process; consumer only, no lock or syscall
+//   void wait(const std::atomic<bool>&);     block the consumer while empty and running
+//   void wait_until(const std::atomic<bool>&, Clock::time_point);  same, at most until then
+//   void close();                            wake the consumer unconditionally and release
+//                                               producers blocked on a full queue (stop)
+//   void open();                             undo close() before the consumer restarts (start)
+namespace queue {
+  using Clock = std::chrono::steady_clock;
+
+  enum Status : int {
+    Accepted, // queued
+    Dropped,  // queued, after discarding older messages to make room
+    Full,     // refused: the mailbox is at capacity
+    Closed,   // refused: the mailbox is stopped
+  };
+
+  struct Pushed {
+    Status status;
+    size_t dropped; // older messages discarded to make room
+    size_t refused; // messages not queued; part of a batch may be queued before the rest is refused
+  };
+
+  // What a push into a full bounded mailbox does.
+  enum Overflow : int {
+    Block,      // waits for the consumer to make room; the consumer itself gets Full
+    Fail,       // returns Full; a batch is queued entirely or not at all
+    DropOldest, // discards the oldest messages, unrun
+  };
+
+  namespace details {
+    // A per-thread address identifying the calling thread, to tell the consumer from producers.
+    inline const void* thread() {
+      static thread_local char tag;
+      return &tag;
+    }
+  } // details
+
+  template<class E> struct Stamped {
+    template<class F> Stamped(F&& f, stats::Stamp stamp) : e(std::forward<F>(f)), stamp(stamp) {}
+    E e;
+    stats::Stamp stamp;
+  };
+
+  // std::deque under a mutex; one lock and one notify per push, one lock per pop.
+  // The length is mirrored in an atomic so that a polling consumer does not take the lock.
+  template<class E, class C = std::deque<Stamped<E>>> class Locked {
+    std::mutex m;
+    std::condition_variable cv;
+    C queue;
+    std::atomic<size_t> size {0};
+  public:
+    template<class F> Pushed push(F&& f, stats::Stamp stamp = 0) {
+      std::unique_lock<std::mutex> l(m);
+      queue.emplace_back(std::forward<F>(f), stamp);
+      size.store(queue.size(), std::memory_order_release);
+      cv.notify_one();
+      return Pushed {Accepted, 0, 0};
+    }
+    template<class It> Pushed push(It first, It last, stats::Stamp stamp = 0) {
+      std::unique_lock<std::mutex> l(m);
+      for (; first != last; ++first, stamp = 0)
+        queue.emplace_back(std::move(*first), stamp);
+      size.store(queue.size(), std::memory_order_release);
+      cv.notify_one();
+      return Pushed {Accepted, 0, 0};
+    }
+    template<class F> Pushed force(F&& f, stats::Stamp stamp = 0) { return push(std::forward<F>(f), stamp); }
+    template<class P> bool process(P&& probe) {
+      E e;
+      stats::Stamp stamp;
+      {
+        std::unique_lock<std::mutex> l(m);
+        if (queue.empty()) return false;
+        std::swap(e, queue.front().e);
+        stamp = queue.front().stamp;
+        queue.pop_front();
+        size.store(queue.size(), std::memory_order_relaxed);
+      }
+      probe(stamp);
+      e();
+      return true;
+    }
+    bool process() { return process([](stats::Stamp) {}); }
+    bool empty() const {
+      return not size.load(std::memory_order_acquire);
+    }
+    void wait(const std::atomic<bool>& running) {
+      std::unique_lock<std::mutex> l(m);
+      while (queue.empty() and running)
+        cv.wait(l);
+    }
+    void wait_until(const std::atomic<bool>& running, Clock::time_point deadline) {
+      if (deadline == Clock::time_point::max())
+        return wait(running);
+      std::unique_lock<std::mutex> l(m);
+      while (queue.empty() and running)
+        if (cv.wait_until(l, deadline) == std::cv_status::timeout)
+          return;
+    }
+    void close() {
+      std::unique_lock<std::mutex> l(m);
+      cv.notify_one();
+    }
+    void open() {}
+  };
+
+  // Locked holding at most Capacity messages, with Policy deciding what a push into a full one does.
+  // close() (Thread<>::stop) also releases blocked producers with Closed, and refuses any push
+  // that would block until open(). Messages from force() bypass the bound: they wait in a queue of
+  // their own that runs ahead of the backlog and is never dropped from.
+  // The consumer never waits on its own full mailbox: under Block, what it cannot push is refused
+  // with Full, as under Fail.
+  template<class E, size_t Capacity, Overflow Policy = Block, class C = std::deque<Stamped<E>>> class Bounded {
+    static_assert(Capacity > 0, "Bounded capacity must be positive");
+    std::mutex m;
+    std::condition_variable cv;   // consumer: not empty
+    std::condition_variable room; // producers: not full
+    C queue;
+    C forced;                     // force()d messages, outside the capacity
+    std::atomic<size_t> size {0};
+    bool closed = false;
+    const void* consumer = nullptr; // details::thread() of the last thread to process
+
+    bool consuming() const { return consumer == details::thread(); }
+
+    // Waits until n more messages fit; false once closed.
+    bool reserve(std::unique_lock<std::mutex>& l, size_t n) {
+      while (queue.size() + n > Capacity) {
+        if (closed)
+          return false;
+        room.wait(l);
+      }
+      return true;
+    }
+    // Moves the oldest message to `dropped`, to be destroyed once the lock is released.
+    void drop(C& dropped) {
+      dropped.push_back(std::move(queue.front()));
+      queue.pop_front();
+    }
+    void published() {
+      size.store(queue.size() + forced.size(), std::memory_order_release);
+      cv.notify_one();
+    }
+    bool idle() const { return queue.empty() and forced.empty(); }
+  public:
+    template<class F> Pushed push(F&& f, stats::Stamp stamp = 0) {
+      C dropped;
+      std::unique_lock<std::mutex> l(m);
+      if (queue.size() >= Capacity) {
+        if (Policy == Fail or (Policy == Block and consuming()))
+          return Pushed {Full, 0, 1};
+        if (Policy == Block and not reserve(l, 1))
+          return Pushed {Closed, 0, 1};
+        if (Policy == DropOldest)
+          drop(dropped);
+      }
+      queue.emplace_back(std::forward<F>(f), stamp);
+      published();
+      l.unlock();
+      return Pushed {dropped.empty() ? Accepted : Dropped, dropped.size(), 0};
+    }
+    // Under Block, a batch larger than the free space goes in as room appears, waking the consumer
+    // for each part; if the queue closes meanwhile, the part not yet queued is refused.
+    template<class It> Pushed push(It first, It last, stats::Stamp stamp = 0) {
+      size_t n = size_t(std::distance(first, last));
+      C dropped;
+      std::unique_lock<std::mutex> l(m);
+      if (Policy == Fail and queue.size() + n > Capacity)
+        return Pushed {Full, 0, n};
+      for (size_t i = 0; first != last; ++first, ++i, stamp = 0) {
+        if (queue.size() >= Capacity) {
+          if (Policy == DropOldest)
+            drop(dropped);
+          else {
+            published();
+            if (consuming())
+              return Pushed {Full, 0, n - i};
+            if (not reserve(l, 1))
+              return Pushed {Closed, 0, n - i};
+          }
+        }
+        queue.emplace_back(std::move(*first), stamp);
+      }
+      published();
+      l.unlock();
+      return Pushed {dropped.empty() ? Accepted : Dropped, dropped.size(), 0};
+    }
+    template<class F> Pushed force(F&& f, stats::Stamp stamp = 0) {
+      std::unique_lock<std::mutex> l(m);
+      forced.emplace_back(std::forward<F>(f), stamp);
+      published();
+      return Pushed {Accepted, 0, 0};
+    }
+    template<class P> bool process(P&& probe) {
+      E e;
+      stats::Stamp stamp;
+      {
+        std::unique_lock<std::mutex> l(m);
+        consumer = details::thread();
+        C& from = forced.empty() ? queue : forced;
+        if (from.empty()) return false;
+        std::swap(e, from.front().e);
+        stamp = from.front().stamp;
+        from.pop_front();
+        size.store(queue.size() + forced.size(), std::memory_order_relaxed);
+        if (Policy == Block and &from == &queue)
+          room.notify_one();
+      }
+      probe(stamp);
+      e();
+      return true;
+    }
+    bool process() { return process([](stats::Stamp) {}); }
+    bool empty() const {
+      return not size.load(std::memory_order_acquire);
+    }
+    void wait(const std::atomic<bool>& running) {
+      std::unique_lock<std::mutex> l(m);
+      while (idle() and running)
+        cv.wait(l);
+    }
+    void wait_until(const std::atomic<bool>& running, Clock::time_point deadline) {
+      if (deadline == Clock::time_point::max())
+        return wait(running);
+      std::unique_lock<std::mutex> l(m);
+      while (idle() and running)
+        if (cv.wait_until(l, deadline) == std::cv_status::timeout)
+          return;
+    }
+    void close() {
+      std::unique_lock<std::mutex> l(m);
+      closed = true;
+      cv.notify_one();
+      room.notify_all();
+    }
+    void open() {
+      std::unique_lock<std::mutex> l(m);
+      consumer = nullptr; // the next consumer is a new thread
+      closed = false;
+    }
+  };
+
+  // Lock-free multi-producer/single-consumer queue.
+  // Nodes come from the producer's pool cache and go back to it from the consumer.
+  // Producers CAS nodes onto a LIFO stack; the consumer takes the whole stack with one exchange,
+  // reverses it into a private FIFO batch and pops from that without further synchronization.
+  // The consumer parks on a futex only after it has seen the stack empty, and producers only
+  // issue a wake-up when they push onto an empty stack while the consumer is parked.
+  template<class E> class Mpsc {
+    struct Node {
+      static void* operator new(size_t n) { return pool::allocate(n); }
+      static void operator delete(void* p, size_t n) { pool::deallocate(p, n); }
+      template<class F> Node(F&& f, stats::Stamp stamp) : e(std::forward<F>(f)), stamp(stamp) {}
+      Node* next = nullptr;
+      E e;
+      stats::Stamp stamp;
+    };
+    std::atomic<Node*> head {nullptr};
+    char pad[64];
+    Node* batch = nullptr;
+    std::atomic<uint32_t> sleeping {0};
+
+    static void release(Node* n) {
+      while (n) {
+        Node* next = n->next;
+        delete n;
+        n = next;
+      }
+    }
+    // Pushes the chain top..bottom.
+    void splice(Node* top, Node* bottom) {
+      Node* h = head.load(std::memory_order_relaxed);
+      do {
+        bottom->next = h;
+      } while (not head.compare_exchange_weak(h, top, std::memory_order_seq_cst, std::memory_order_relaxed));
+      if (not h and sleeping.load(std::memory_order_seq_cst) and sleeping.exchange(0))
+        futex::wake(sleeping);
+    }
+    bool refill() {
+      Node* n = head.exchange(nullptr, std::memory_order_acquire);
+      while (n) {
+        Node* next = n->next;
+        n->next = batch;
+        batch = n;
+        n = next;
+      }
+      return batch;
+    }
+  public:
+    Mpsc() = default;
+    Mpsc(const Mpsc&) = delete;
+    Mpsc& operator=(const Mpsc&) = delete;
+    ~Mpsc() {
+      release(batch);
+      release(head.load(std::memory_order_acquire));
+    }
+    template<class F> Pushed push(F&& f, stats::Stamp stamp = 0) {
+      Node* n = new Node(std::forward<F>(f), stamp);
+      splice(n, n);
+      return Pushed {Accepted, 0, 0};
+    }
+    // The range is chained privately, newest first, and spliced onto the stack with one CAS.
+    template<class It> Pushed push(It first, It last, stats::Stamp stamp = 0) {
+      Node* top = nullptr;
+      Node* bottom = nullptr;
+      try {
+        for (; first != last; ++first, stamp = 0) {
+          Node* n = new Node(std::move(*first), stamp);
+          n->next = top;
+          top = n;
+          if (not bottom)
+            bottom = n;
+        }
+      } catch(...) {
+        release(top);
+        throw;
+      }
+      if (top)
+        splice(top, bottom);
+      return Pushed {Accepted, 0, 0};
+    }
+    template<class F> Pushed force(F&& f, stats::Stamp stamp = 0) { return push(std::forward<F>(f), stamp); }
+    template<class P> bool process(P&& probe) {
+      if (not batch and not refill())
+        return false;
+      std::unique_ptr<Node> n(batch);
+      batch = n->next;
+      probe(n->stamp);
+      n->e();
+      return true;
+    }
+    bool process() { return process([](stats::Stamp) {}); }
+    bool empty() const {
+      return not batch and not head.load(std::memory_order_acquire);
+    }
+    // Whether producers pushed since the consumer last took the stack; safe from any thread.
+    bool pushed() const {
+      return head.load(std::memory_order_seq_cst);
+    }
+    void wait(const std::atomic<bool>& running) {
+      wait_until(running, Clock::time_point::max());
+    }
+    void wait_until(const std::atomic<bool>& running, Clock::time_point deadline) {
+      bool forever = deadline == Clock::time_point::max();
+      while (running and not batch and not head.load(std::memory_order_acquire)) {
+        Clock::duration left = forever ? Clock::duration::zero() : deadline - Clock::now();
+        if (not forever and left <= Clock::duration::zero())
+          return;
+        sleeping.store(1, std::memory_order_seq_cst);
+        if (running and not head.load(std::memory_order_seq_cst)) {
+          if (forever)
+            futex::wait(sleeping, 1);
+          else
+            futex::wait(sleeping, 1, left);
+        }
+        sleeping.store(0, std::memory_order_relaxed);
+      }
+    }
+    void close() {
+      sleeping.store(0, std::memory_order_seq_cst);
+      futex::wake(sleeping);
+    }
+    void open() {}
+  };
+
+  // Closures type-erased in place in a contiguous byte ring, each entry sized to its closure
+  // plus a 16-byte header. Small messages pack densely and large captures never touch the heap
+  // unless they exceed Capacity / 16, in which case only a pointer is stored in the ring.
+  // Producers reserve space with a CAS on the tail and publish by storing the entry size;
+  // the consumer runs entries in place, zeroes them and advances the head. A full ring parks
+  // producers on a futex until the consumer frees space or close() releases them with Closed.
+  // The consumer never parks on its own ring: what it pushes while the ring is full goes to a
+  // private overflow list, each entry heap-allocated and run once the ring has drained up to the
+  // position it would have taken, so messages from one thread still run in the order they were sent.
+  template<size_t Capacity = (1 << 16)> class Ring {
+    static_assert(Capacity and not (Capacity & (Capacity - 1)), "Ring capacity must be a power of two");
+    struct Ops {
+      void (*run)(void*);
+      void (*drop)(void*);
+    };
+    struct alignas(16) Header {
+      std::atomic<uint32_t> size; // whole entry in bytes; 0 until published
+      stats::Stamp stamp;
+      const Ops* ops;             // nullptr marks the filler before a wrap-around
+    };
+    static_assert(sizeof(Header) == 16, "Ring entries carry a 16-byte header");
+    struct alignas(16) Slot { unsigned char b[16]; };
+    static constexpr size_t Align = sizeof(Slot);
+    static constexpr size_t MaxInline = Capacity / 16;
+
+    template<class F> struct Entry {
+      static void run(void* p) {
+        struct Guard { F& f; ~Guard() { f.~F(); } } g { *static_cast<F*>(p) };
+        g.f();
+      }
+      static void drop(void* p) { static_cast<F*>(p)->~F(); }
+      static const Ops ops;
+    };
+    template<class F> struct Boxed {
+      explicit Boxed(F&& f) : f(new F(std::move(f))) {}
+      explicit Boxed(const F& f) : f(new F(f)) {}
+      void operator()() { (*f)(); }
+      std::unique_ptr<F> f;
+    };
+    template<class F, bool = (sizeof(F) <= MaxInline and alignof(F) <= Align)> struct Store {
+      using type = F;
+    };
+    template<class F> struct Store<F, false> {
+      using type = Boxed<F>;
+    };
+
+    // An entry the consumer pushed while the ring was full.
+    struct Spilled {
+      uint64_t pos; // tail when it was pushed: it runs once the head gets there
+      stats::Stamp stamp;
+      const Ops* ops;
+      void* p;
+      size_t size;
+    };
+
+    std::unique_ptr<Slot[]> ring {new Slot[Capacity / Align]()};
+    char pad0[64];
+    std::atomic<uint64_t> tail {0};
+    char pad1[64];
+    std::atomic<uint64_t> head {0};
+    uint64_t next = 0; // consumer's copy of head
+    std::atomic<const void*> consumer {nullptr}; // details::thread() of the last thread to process
+    std::deque<Spilled> spilled;                 // consumer only
+    std::atomic<uint32_t> sleeping {0};
+    std::atomic<uint32_t> full {0};
+    std::atomic<bool> closed {false};
+
+    Header* at(uint64_t pos) const { return reinterpret_cast<Header*>(ring[(pos & (Capacity - 1)) / Align].b); }
+    static constexpr size_t round(size_t n) { return (n + Align - 1) & ~(Align - 1); }
+
+    bool consuming() const { return consumer.load(std::memory_order_relaxed) == details::thread(); }
+
+    // Sets pos to a header with room for `size` bytes, after a filler if it had to wrap. On a full
+    // ring, false instead of waiting if the caller is the consumer or the ring is closed.
+    bool reserve(size_t size, uint64_t& pos) {
+      uint64_t t = tail.load(std::memory_order_relaxed);
+      for (;;) {
+        size_t off = t & (Capacity - 1);
+        size_t filler = off + size > Capacity ? Capacity - off : 0;
+        if (t + filler + size - head.load(std::memory_order_acquire) > Capacity) {
+          if (consuming())
+            return false;
+          full.store(1, std::memory_order_seq_cst);
+          if (closed.load(std::memory_order_seq_cst))
+            return false;
+          if (t + filler + size - head.load(std::memory_order_seq_cst) > Capacity)
+            futex::wait(full, 1);
+          t = tail.load(std::memory_order_relaxed);
+          continue;
+        }
+        if (tail.compare_exchange_weak(t, t + filler + size, std::memory_order_relaxed, std::memory_order_relaxed)) {
+          if (filler)
+            publish(at(t), filler, nullptr);
+          pos = t + filler;
+          return true;
+        }
+      }
+    }
+    void publish(Header* h, size_t size, const Ops* ops) {
+      h->ops = ops;
+      h->size.store(static_cast<uint32_t>(size), std::memory_order_seq_cst);
+    }
+    void release(Header* h, size_t size) {
+      std::memset(static_cast<void*>(h), 0, size);
+      next += size;
+      head.store(next, std::memory_order_seq_cst);
+      if (full.load(std::memory_order_seq_cst) and full.exchange(0))
+        futex::wake(full, INT_MAX);
+    }
+    bool ready() const {
+      return at(next)->size.load(std::memory_order_seq_cst) or (not spilled.empty() and spilled.front().pos <= next);
+    }
+    // False if the ring is closed and full.
+    template<class F> bool emplace(F&& f, stats::Stamp stamp) {
+      using T = typename Store<typename std::decay<F>::type>::type;
+      size_t size = round(sizeof(Header) + sizeof(T));
+      uint64_t pos;
+      if (not reserve(size, pos)) {
+        if (not consuming())
+          return false;
+        void* p = pool::allocate(sizeof(T));
+        try {
+          ::new (p) T(std::forward<F>(f));
+          spilled.push_back(Spilled {tail.load(std::memory_order_relaxed), stamp, &Entry<T>::ops, p, sizeof(T)});
+        } catch(...) {
+          pool::deallocate(p, sizeof(T));
+          throw;
+        }
+        return true;
+      }
+      Header* h = at(pos);
+      h->stamp = stamp;
+      try {
+        ::new (static_cast<void*>(h + 1)) T(std::forward<F>(f));
+      } catch(...) {
+        publish(h, size, nullptr); // the consumer skips it like a filler
+        throw;
+      }
+      publish(h, size, &Entry<T>::ops);
+      return true;
+    }
+    void wake() {
+      if (sleeping.load(std::memory_order_seq_cst) and sleeping.exchange(0))
+        futex::wake(sleeping);
+    }
+  public:
+    Ring() = default;
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+    ~Ring() {
+      while (Header* h = at(next)->size.load(std::memory_order_acquire) ? at(next) : nullptr) {
+        size_t size = h->size.load(std::memory_order_acquire);
+        if (h->ops)
+          h->ops->drop(h + 1);
+        release(h, size);
+      }
+      for (Spilled& s: spilled) {
+        s.ops->drop(s.p);
+        pool::deallocate(s.p, s.size);
+      }
+    }
+    template<class F> Pushed push(F&& f, stats::Stamp stamp = 0) {
+      if (not emplace(std::forward<F>(f), stamp))
+        return Pushed {Closed, 0, 1};
+      wake();
+      return Pushed {Accepted, 0, 0};
+    }
+    // Entries vary in size, so each still reserves its own space; only the wake-up is shared.
+    template<class It> Pushed push(It first, It last, stats::Stamp stamp = 0) {
+      struct Guard { Ring& r; ~Guard() { r.wake(); } } g { *this };
+      size_t n = size_t(std::distance(first, last));
+      for (size_t i = 0; first != last; ++first, ++i, stamp = 0)
+        if (not emplace(std::move(*first), stamp))
+          return Pushed {Closed, 0, n - i};
+      return Pushed {Accepted, 0, 0};
+    }
+    // The ring has no bound to bypass: only a full ring's consumer skips the wait (see above).
+    template<class F> Pushed force(F&& f, stats::Stamp stamp = 0) { return push(std::forward<F>(f), stamp); }
+    template<class P> bool process(P&& probe) {
+      if (not consuming())
+        consumer.store(details::thread(), std::memory_order_relaxed);
+      if (not spilled.empty() and spilled.front().pos <= next) {
+        Spilled s = spilled.front();
+        spilled.pop_front();
+        struct Guard { Spilled& s; ~Guard() { pool::deallocate(s.p, s.size); } } g { s };
+        probe(s.stamp);
+        s.ops->run(s.p);
+        return true;
+      }
+      Header* h = at(next);
+      size_t size = h->size.load(std::memory_order_acquire);
+      if (not size)
+        return false;
+      if (not h->ops) {
+        release(h, size);
+        return process(std::forward<P>(probe));
+      }
+      struct Guard { Ring& r; Header* h; size_t size; ~Guard() { r.release(h, size); } } g { *this, h, size };
+      probe(h->stamp);
+      h->ops->run(h + 1);
+      return true;
+    }
+    bool process() { return process([](stats::Stamp) {}); }
+    bool empty() const {
+      return not ready();
+    }
+    void wait(const std::atomic<bool>& running) {
+      wait_until(running, Clock::time_point::max());
+    }
+    void wait_until(const std::atomic<bool>& running, Clock::time_point deadline) {
+      bool forever = deadline == Clock::time_point::max();
+      while (running and not ready()) {
+        Clock::duration left = forever ? Clock::duration::zero() : deadline - Clock::now();
+        if (not forever and left <= Clock::duration::zero())
+          return;
+        sleeping.store(1, std::memory_order_seq_cst);
+        if (running and not ready()) {
+          if (forever)
+            futex::wait(sleeping, 1);
+          else
+            futex::wait(sleeping, 1, left);
+        }
+        sleeping.store(0, std::memory_order_relaxed);
+      }
+    }
+    void close() {
+      closed.store(true, std::memory_order_seq_cst);
+      sleeping.store(0, std::memory_order_seq_cst);
+      futex::wake(sleeping);
+      full.store(0, std::memory_order_seq_cst);
+      futex::wake(full, INT_MAX);
+    }
+    void open() {
+      consumer.store(nullptr, std::memory_order_relaxed); // the next consumer is a new thread
+      closed.store(false, std::memory_order_seq_cst);
+    }
+  };
+
+  template<size_t Capacity> template<class F>
+  const typename Ring<Capacity>::Ops Ring<Capacity>::Entry<F>::ops = { &Entry<F>::run, &Entry<F>::drop };
+} // queue
@@ -0,0 +1,311 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include <demangle.hh>
+#include <pool.hh>
+
+// Always-on instrumentation; -DSMUNIX_STATS=0 compiles every hook out.
+// Hot-path counters have a single writer and are bumped with a relaxed load and store;
+// snapshot() sums them on demand, together with the counts left by exited threads:
+//  - per smunix::function signature and Sz, in thread-local counters: constructions stored
+//    inline and on the heap, clones, and bytes allocated through the _Alloc path;
+//  - per Thread<> mailbox: enqueues (striped across producers), dequeues, messages a bounded
+//    mailbox refused or dropped, and, on one message in Period stamped by its producer, the
+//    backlog depth and the enqueue-to-execution delay.
+#ifndef SMUNIX_STATS
+#define SMUNIX_STATS 1
+#endif
+
+namespace stats {
+  // Low 32 bits of a steady_clock nanosecond count, 0 when the message is not sampled.
+  // Delays are taken modulo 2^32 ns, so waits beyond ~4.29 s alias.
+  using Stamp = uint32_t;
+  constexpr uint32_t Period = 64;
+  constexpr size_t Buckets = 33; // wait histogram: bucket b holds delays in [2^(b-1), 2^b) ns
+
+  struct Function {
+    std::string signature;
+    size_t sz;
+    uint64_t local = 0;  // constructions stored in the small buffer
+    uint64_t heap = 0;   // constructions spilled through the allocator
+    uint64_t clones = 0; // copies
+    uint64_t bytes = 0;  // allocated by heap constructions and heap clones
+  };
+
+  struct Queue {
+    uint64_t id;
+    uint64_t enqueued = 0;    // posted, including those refused or dropped
+    uint64_t dequeued = 0;
+    uint64_t rejected = 0;    // refused by a full or stopped mailbox
+    uint64_t dropped = 0;     // discarded unrun to make room
+    uint64_t max_depth = 0;   // deepest backlog seen by a sampled message
+    uint64_t sampled = 0;     // messages timed
+    uint64_t wait_ns = 0;     // total enqueue-to-execution delay of the sampled messages
+    uint64_t max_wait_ns = 0;
+    uint64_t histogram[Buckets] = {};
+  };
+
+  struct Snapshot {
+    std::vector<Function> functions;
+    std::vector<Queue> queues;
+    pool::Stats pool;
+  };
+
+  class Mailbox;
+
+  namespace details {
+    using pool::details::Counter;
+
+    enum { Local, Heap, Clones, Bytes, Kinds };
+
+    struct Key {
+      const std::type_info* signature;
+      size_t sz;
+      uint64_t retired[Kinds];
+    };
+
+    struct Slot {
+      Key* key;
+      Counter c[Kinds];
+    };
+
+    struct Registry {
+      std::mutex m;
+      std::vector<Key*> keys;
+      std::vector<Slot*> slots;
+      std::vector<Mailbox*> mailboxes;
+      uint64_t ids = 0;
+    };
+
+    inline Registry& registry() {
+      static Registry* r = new Registry; // outlives every thread-local slot
+      return *r;
+    }
+
+    inline Key* add(const std::type_info& signature, size_t sz) {
+      Registry& r = registry();
+      std::unique_lock<std::mutex> l(r.m);
+      r.keys.push_back(new Key {&signature, sz, {}});
+      return r.keys.back();
+    }
+
+    // A thread's counters for one (signature, Sz); folded into the key when the thread exits.
+    struct Owner {
+      Slot slot;
+      explicit Owner(Key* k) {
+        slot.key = k;
+        Registry& r = registry();
+        std::unique_lock<std::mutex> l(r.m);
+        r.slots.push_back(&slot);
+      }
+      ~Owner() {
+        Registry& r = registry();
+        std::unique_lock<std::mutex> l(r.m);
+        for (size_t i = 0; i < Kinds; ++i)
+          slot.key->retired[i] += slot.c[i].load();
+        r.slots.erase(std::find(r.slots.begin(), r.slots.end(), &slot));
+      }
+    };
+
+    template<class Fp, size_t Sz> Key* key() {
+      static Key* k = add(typeid(Fp), Sz);
+      return k;
+    }
+
+    template<class Fp, size_t Sz> Slot& slot() {
+      static thread_local Owner o(key<Fp, Sz>());
+      return o.slot;
+    }
+
+    inline uint64_t now() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    inline size_t bucket(uint32_t ns) {
+      return ns ? 32 - __builtin_clz(ns) : 0;
+    }
+  } // details
+
+  // Hooks called by smunix::function<Fp, Sz>.
+  template<class Fp, size_t Sz> struct function {
+    static void local() {
+#if SMUNIX_STATS
+      details::slot<Fp, Sz>().c[details::Local] += 1;
+#endif
+    }
+    static void heap(size_t bytes) {
+#if SMUNIX_STATS
+      details::Slot& s = details::slot<Fp, Sz>();
+      s.c[details::Heap] += 1;
+      s.c[details::Bytes] += bytes;
+#endif
+    }
+    static void clone(size_t bytes) {
+#if SMUNIX_STATS
+      details::Slot& s = details::slot<Fp, Sz>();
+      s.c[details::Clones] += 1;
+      s.c[details::Bytes] += bytes;
+#endif
+    }
+  };
+
+  // Counters of one Thread<> mailbox. Producers call enqueue() and store the returned stamp with
+  // the message, or with the first of a batch of n; the consumer calls dequeue() with it just
+  // before running the message. Producers report refused and discarded messages, a rare path,
+  // with reject() and drop().
+  class Mailbox {
+  public:
+    Mailbox() {
+      details::Registry& r = details::registry();
+      std::unique_lock<std::mutex> l(r.m);
+      id = ++r.ids;
+      r.mailboxes.push_back(this);
+    }
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+    ~Mailbox() {
+      details::Registry& r = details::registry();
+      std::unique_lock<std::mutex> l(r.m);
+      r.mailboxes.erase(std::find(r.mailboxes.begin(), r.mailboxes.end(), this));
+    }
+    Stamp enqueue(size_t n = 1) {
+#if SMUNIX_STATS
+      // The stripe's own count sets the sampling phase, so it is kept per mailbox: a producer
+      // alternating between mailboxes still samples each of them.
+      uint64_t before = stripe().fetch_add(n, std::memory_order_relaxed);
+      if (before / Period == (before + n) / Period)
+        return 0;
+      Stamp s = Stamp(details::now());
+      return s ? s : 1;
+#else
+      (void)n;
+      return 0;
+#endif
+    }
+    void reject(size_t n) {
+#if SMUNIX_STATS
+      rejected.fetch_add(n, std::memory_order_relaxed);
+#else
+      (void)n;
+#endif
+    }
+    void drop(size_t n) {
+#if SMUNIX_STATS
+      dropped.fetch_add(n, std::memory_order_relaxed);
+#else
+      (void)n;
+#endif
+    }
+    void dequeue(Stamp s) {
+#if SMUNIX_STATS
+      dequeued += 1;
+      if (not s)
+        return;
+      uint32_t w = Stamp(details::now()) - s;
+      sampled += 1;
+      wait += w;
+      if (w > max_wait.load())
+        max_wait.v.store(w, std::memory_order_relaxed);
+      histogram[details::bucket(w)] += 1;
+      uint64_t e = enqueued(), d = dequeued.load() + rejected.load(std::memory_order_relaxed) + dropped.load(std::memory_order_relaxed);
+      if (e > d and e - d > max_depth.load())
+        max_depth.v.store(e - d, std::memory_order_relaxed);
+#else
+      (void)s;
+#endif
+    }
+    Queue snapshot() const {
+      Queue q;
+      q.id = id;
+      q.enqueued = enqueued();
+      q.dequeued = dequeued.load();
+      q.rejected = rejected.load(std::memory_order_relaxed);
+      q.dropped = dropped.load(std::memory_order_relaxed);
+      q.max_depth = max_depth.load();
+      q.sampled = sampled.load();
+      q.wait_ns = wait.load();
+      q.max_wait_ns = max_wait.load();
+      for (size_t b = 0; b < Buckets; ++b)
+        q.histogram[b] = histogram[b].load();
+      return q;
+    }
+  private:
+    static constexpr size_t Stripes = 8;
+    struct Stripe {
+      std::atomic<uint64_t> n {0};
+      char pad[64 - sizeof(std::atomic<uint64_t>)];
+    };
+    std::atomic<uint64_t>& stripe() {
+      static std::atomic<size_t> next {0};
+      static thread_local size_t i = next.fetch_add(1, std::memory_order_relaxed) % Stripes;
+      return stripes[i].n;
+    }
+    uint64_t enqueued() const {
+      uint64_t n = 0;
+      for (auto& s: stripes)
+        n += s.n.load(std::memory_order_relaxed);
+      return n;
+    }
+
+    Stripe stripes[Stripes];
+    std::atomic<uint64_t> rejected {0}, dropped {0};
+    // Written by the consumer only.
+    details::Counter dequeued, sampled, wait, max_wait, max_depth;
+    details::Counter histogram[Buckets];
+    uint64_t id;
+  };
+
+  inline Snapshot snapshot() {
+    Snapshot s;
+    {
+      details::Registry& r = details::registry();
+      std::unique_lock<std::mutex> l(r.m);
+      for (details::Key* k: r.keys) {
+        uint64_t c[details::Kinds];
+        std::copy(k->retired, k->retired + details::Kinds, c);
+        for (details::Slot* t: r.slots)
+          if (t->key == k)
+            for (size_t i = 0; i < details::Kinds; ++i)
+              c[i] += t->c[i].load();
+        Function f;
+        f.signature = cpp::demangle(k->signature->name());
+        f.sz = k->sz;
+        f.local = c[details::Local];
+        f.heap = c[details::Heap];
+        f.clones = c[details::Clones];
+        f.bytes = c[details::Bytes];
+        s.functions.push_back(f);
+      }
+      for (Mailbox* m: r.mailboxes)
+        s.queues.push_back(m->snapshot());
+    }
+    s.pool = pool::stats();
+    return s;
+  }
+
+  inline std::ostream& operator<<(std::ostream& os, const Snapshot& s) {
+    for (const Function& f: s.functions)
+      os << "function<" << f.signature << ", " << f.sz << ">: local=" << f.local << " heap=" << f.heap
+         << " clones=" << f.clones << " bytes=" << f.bytes << '\n';
+    for (const Queue& q: s.queues) {
+      os << "mailbox " << q.id << ": enqueued=" << q.enqueued << " dequeued=" << q.dequeued << " rejected=" << q.rejected
+         << " dropped=" << q.dropped << " max_depth=" << q.max_depth
+         << " sampled=" << q.sampled << " mean_wait_ns=" << (q.sampled ? q.wait_ns / q.sampled : 0) << " max_wait_ns=" << q.max_wait_ns
+         << " wait_histogram_log2_ns=";
+      for (size_t b = 0; b < Buckets; ++b)
+        if (q.histogram[b])
+          os << '[' << b << "]=" << q.histogram[b] << ' ';
+      os << '\n';
+    }
+    os << "pool: allocations=" << s.pool.allocations << " deallocations=" << s.pool.deallocations << " remote=" << s.pool.remote
+       << " refills=" << s.pool.refills << " large=" << s.pool.large << " bytes=" << s.pool.bytes << '\n';
+    return os;
+  }
+} // stats
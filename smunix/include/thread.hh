@@ -0,0 +1,193 @@
+#pragma once
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <functional.H>
+#include <future.hh>
+#include <queue.hh>
+#include <stats.hh>
+#include <timer.hh>
+#include <idle.hh>
+
+struct ThreadTraits {
+  using Element = smunix::function<void(), 8>;
+  using Queue = queue::Locked<Element>;
+};
+
+// Lock-free mailbox: producers never take a lock, the dispatcher drains the backlog in batches.
+struct MpscThreadTraits {
+  using Element = smunix::function<void(), 8>;
+  using Queue = queue::Mpsc<Element>;
+};
+
+// Closures stored inline in a 64 KiB byte ring instead of one fixed-size Element each.
+struct RingThreadTraits {
+  using Element = smunix::function<void(), 8>;
+  using Queue = queue::Ring<(1 << 16)>;
+};
+
+// Locked mailbox holding at most Capacity messages; Policy says what posting to a full one does.
+template<size_t Capacity = 1024, queue::Overflow Policy = queue::Block> struct BoundedThreadTraits {
+  using Element = smunix::function<void(), 8>;
+  using Queue = queue::Bounded<Element, Capacity, Policy>;
+};
+
+// Where the dispatcher runs, applied by the dispatcher itself before its first message.
+struct Placement {
+  std::string name; // thread name, cut to the 15 characters Linux keeps; unchanged if empty
+  int cpu = -1;     // the only CPU the dispatcher may run on; unpinned if negative
+
+  void apply() const {
+    if (not name.empty())
+      pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    if (cpu >= 0 and cpu < CPU_SETSIZE) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+  }
+};
+
+// Runs closures posted with exec() in order on one dispatcher thread, and timed ones posted with
+// exec_at/exec_after/exec_every from a timer wheel that the dispatcher idles on between messages.
+// TStrategy (see idle.hh) decides how it idles: sleeping by default, or polling for latency-critical
+// actors, which should then have a CPU of their own through Placement.
+template<class TT = ThreadTraits, bool TWait = true, class TStrategy = idle::Block> struct Thread {
+  using Queue = typename TT::Queue;
+  using Element = typename TT::Element;
+  using Clock = timer::Clock;
+  static constexpr size_t Batch = 64; // messages run between two looks at the timer wheel
+  template<class A> using up = std::unique_ptr<A>;
+  template<class A> using sp = std::shared_ptr<A>;
+
+  explicit Thread(bool a_started = true, Placement a_placement = Placement()) : running(true), placement(std::move(a_placement)) {
+    if (a_started)
+      dispatcher.reset(new std::thread([this](){ apply(); }));
+  }
+  virtual ~Thread() {
+    stop();
+  }
+  void start() {
+    if (not dispatcher) {
+      queue.open();
+      running = true;
+      dispatcher.reset(new std::thread([this](){ apply(); }));
+    }
+  }
+  void stop() {
+    try {
+      if (running) {
+        running = false;
+        queue.close();
+        if (dispatcher) {
+          dispatcher->join();
+          dispatcher.reset();
+        }
+      }
+    } catch(...) {
+    }
+  }
+  // Closed once stopped; a bounded mailbox may also report Full or Dropped.
+  template<class F> queue::Status exec(F&& f) {
+    if (not running) return queue::Closed;
+    return posted(queue.push(std::forward<F>(f), mailbox.enqueue()));
+  }
+  // Posts a forward range of closures, moving from them, with one synchronization and one wake-up.
+  // Closed if stop() cut it short; counters() then count only the part left out as rejected.
+  template<class It> queue::Status exec_many(It first, It last) {
+    if (not running) return queue::Closed;
+    size_t n = size_t(std::distance(first, last));
+    if (not n) return queue::Accepted;
+    return posted(queue.push(first, last, mailbox.enqueue(n)));
+  }
+  template<class F> timer::Handle exec_at(Clock::time_point at, F&& f) {
+    return schedule(at, Clock::duration::zero(), std::forward<F>(f));
+  }
+  template<class F> timer::Handle exec_after(Clock::duration delay, F&& f) {
+    return schedule(Clock::now() + delay, Clock::duration::zero(), std::forward<F>(f));
+  }
+  // First run one period from now.
+  template<class F> timer::Handle exec_every(Clock::duration period, F&& f) {
+    return schedule(Clock::now() + period, period, std::forward<F>(f));
+  }
+  stats::Queue counters() const {
+    return mailbox.snapshot();
+  }
+private:
+  queue::Status posted(queue::Pushed p) {
+    if (p.refused)
+      mailbox.reject(p.refused);
+    if (p.dropped)
+      mailbox.drop(p.dropped);
+    return p.status;
+  }
+  // The dispatcher's own messages: past a bounded mailbox's capacity, and never dropped from it.
+  template<class F> queue::Status post(F&& f) {
+    if (not running) return queue::Closed;
+    return posted(queue.force(std::forward<F>(f), mailbox.enqueue()));
+  }
+  // Coroutines suspended on this thread resume through here.
+  static void resume(void* self, void* frame) {
+    static_cast<Thread*>(self)->post(future::Resume(frame));
+  }
+  // Posted by schedule() to hand a new timer to the dispatcher's wheel.
+  struct Arm {
+    Thread* t;
+    timer::Base* n;
+    Arm(Thread* t, timer::Base* n) : t(t), n(n) {}
+    Arm(Arm&& o) noexcept : t(o.t), n(o.n) { o.n = nullptr; }
+    ~Arm() {
+      if (n)
+        timer::Wheel<Element>::discard(n);
+    }
+    void operator()() {
+      t->timers.insert(n);
+      n = nullptr;
+    }
+  };
+  template<class F> timer::Handle schedule(Clock::time_point at, Clock::duration period, F&& f) {
+    if (not running) return timer::Handle();
+    timer::Base* n = timers.make(at, period, std::forward<F>(f));
+    timer::Handle h(n);
+    if (post(Arm(this, n)) == queue::Closed)
+      return timer::Handle(); // stopped meanwhile: the timer was discarded unarmed
+    return h;
+  }
+  bool process() {
+    return queue.process([this](stats::Stamp s) { mailbox.dequeue(s); });
+  }
+  void apply() {
+    placement.apply();
+    future::current() = &resumer;
+    while(running) {
+      try {
+        while (running) {
+          if (timers.empty())
+            strategy.wait(queue, running, Clock::time_point::max());
+          else {
+            strategy.wait(queue, running, timers.next());
+            timers.expire();
+          }
+          for (size_t n = 1; (running or TWait) and process(); ++n)
+            if (n % Batch == 0 and not timers.empty())
+              timers.expire();
+        }
+      } catch(...) {
+      }
+    }
+  }
+  bool transparent = false;
+  std::atomic<bool> running {false};
+  up<std::thread> dispatcher;
+  Placement placement;
+  TStrategy strategy;
+  future::Executor resumer {this, &Thread::resume};
+  stats::Mailbox mailbox;
+  timer::Wheel<Element> timers;
+  Queue queue;
+};
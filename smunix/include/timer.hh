@@ -0,0 +1,340 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <pool.hh>
+
+// Hierarchical timing wheel (Varghese & Lauck) driven by one dispatcher thread.
+// Four levels of 256 slots cover 2^32 ticks; a timer sits in the lowest level whose slot index
+// is the first that differs between its expiry and the current tick, and is moved down a level
+// each time the level above wraps onto its slot. Timers further out wait in an overflow list.
+// Slots are intrusive doubly-linked lists with an occupancy bitmap, so insert, cancel and the
+// search for the next deadline are O(1).
+//
+// Any thread creates a timer and receives a Handle; the insertion itself is posted to the
+// dispatcher. Handle::cancel() marks the timer and pushes it on a lock-free stack that the
+// dispatcher drains on its next pass, unlinking it and destroying its closure.
+namespace timer {
+  using Clock = std::chrono::steady_clock;
+
+  enum State : int { Pending, Cancelled, Done };
+
+  struct Link {
+    Link* prev;
+    Link* next;
+  };
+
+  struct Base : Link {
+    static void* operator new(size_t n) { return pool::allocate(n); }
+    static void operator delete(void* p, size_t n) { pool::deallocate(p, n); }
+
+    Base* cancelled = nullptr;           // link on the wheel's cancel stack
+    uint64_t expiry = 0;                 // tick
+    uint64_t period = 0;                 // ticks, 0 for a one-shot timer
+    std::atomic<int> state {Pending};
+    std::atomic<int> refs {2};           // the handle and the wheel
+    std::atomic<Base*>* stack = nullptr; // the owning wheel's cancel stack
+    void (*destroy)(Base*) = nullptr;
+    // Dispatcher only.
+    bool linked = false;
+    uint8_t level = 0;                   // Levels for the overflow list
+    uint8_t slot = 0;
+
+    void release() {
+      if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        destroy(this);
+    }
+  };
+
+  template<class E> struct Node : Base {
+    template<class F> explicit Node(F&& f) : f(std::forward<F>(f)) {
+      destroy = [](Base* b) { delete static_cast<Node*>(b); };
+    }
+    E f;
+  };
+
+  // Cancellable reference to a timer; dropping it neither cancels nor leaks the timer.
+  class Handle {
+    Base* n = nullptr;
+  public:
+    Handle() = default;
+    explicit Handle(Base* n) : n(n) {}
+    Handle(const Handle& o) : n(o.n) {
+      if (n)
+        n->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    Handle(Handle&& o) noexcept : n(o.n) { o.n = nullptr; }
+    Handle& operator=(Handle o) noexcept {
+      std::swap(n, o.n);
+      return *this;
+    }
+    ~Handle() {
+      if (n)
+        n->release();
+    }
+    // True if this call stopped the timer: a one-shot timer had not started to run, a periodic
+    // one will not run again. Any thread, including the timer's own closure.
+    bool cancel() {
+      int s = Pending;
+      if (not n or not n->state.compare_exchange_strong(s, Cancelled, std::memory_order_acq_rel))
+        return false;
+      n->refs.fetch_add(1, std::memory_order_relaxed); // held by the cancel stack
+      Base* h = n->stack->load(std::memory_order_relaxed);
+      do {
+        n->cancelled = h;
+      } while (not n->stack->compare_exchange_weak(h, n, std::memory_order_release, std::memory_order_relaxed));
+      return true;
+    }
+    bool pending() const { return n and n->state.load(std::memory_order_acquire) == Pending; }
+    explicit operator bool() const { return n; }
+  };
+
+  template<class E> class Wheel {
+    static constexpr unsigned Bits = 8;
+    static constexpr unsigned Levels = 4;
+    static constexpr uint64_t Slots = 1 << Bits;
+    static constexpr uint64_t Mask = Slots - 1;
+
+    struct List {
+      Link head;
+      List() { head.prev = head.next = &head; }
+      bool empty() const { return head.next == &head; }
+    };
+    struct Level {
+      List slots[Slots];
+      uint64_t bits[Slots / 64] = {};
+    };
+
+    std::unique_ptr<Level[]> levels; // allocated with the first timer
+    List overflow;
+    Clock::time_point origin;
+    Clock::duration resolution;
+    uint64_t now = 0;   // last tick processed
+    uint64_t until = 0; // tick the running expire() catches up to
+    size_t count = 0; // linked timers
+    std::atomic<Base*> stack {nullptr};
+
+    // First tick at or after t, for deadlines.
+    uint64_t ceil(Clock::time_point t) const {
+      return t <= origin ? 0 : uint64_t((t - origin + resolution - Clock::duration(1)) / resolution);
+    }
+    // Last tick at or before t, for expiry.
+    uint64_t floor(Clock::time_point t) const {
+      return t <= origin ? 0 : uint64_t((t - origin) / resolution);
+    }
+    static void push(List& l, Link* n) {
+      n->prev = l.head.prev;
+      n->next = &l.head;
+      l.head.prev->next = n;
+      l.head.prev = n;
+    }
+    static void remove(Link* n) {
+      n->prev->next = n->next;
+      n->next->prev = n->prev;
+    }
+    // First occupied level-0 slot at or after s, Slots if none before the wrap.
+    uint64_t first(uint64_t s) const {
+      while (s < Slots) {
+        if (uint64_t w = levels[0].bits[s / 64] >> (s % 64))
+          return s + __builtin_ctzll(w);
+        s = (s / 64 + 1) * 64;
+      }
+      return Slots;
+    }
+    void mark(unsigned l, uint64_t s) { levels[l].bits[s / 64] |= uint64_t(1) << (s % 64); }
+    void clear(unsigned l, uint64_t s) { levels[l].bits[s / 64] &= ~(uint64_t(1) << (s % 64)); }
+
+    // During a cascade, the level-0 slot of `now` is yet to be drained, so a timer due right now
+    // still makes it; otherwise that slot is done and a late timer goes to the next tick.
+    void link(Base* n, bool cascading = false) {
+      if (not levels)
+        levels.reset(new Level[Levels]);
+      if (n->expiry < now or (n->expiry == now and not cascading))
+        n->expiry = now + 1;
+      uint64_t diff = n->expiry ^ now;
+      n->linked = true;
+      ++count;
+      for (unsigned l = 0; l < Levels; ++l)
+        if (diff < (uint64_t(1) << (Bits * (l + 1)))) {
+          uint64_t s = (n->expiry >> (Bits * l)) & Mask;
+          n->level = uint8_t(l);
+          n->slot = uint8_t(s);
+          push(levels[l].slots[s], n);
+          mark(l, s);
+          return;
+        }
+      n->level = Levels;
+      push(overflow, n);
+    }
+    void unlink(Base* n) {
+      remove(n);
+      n->linked = false;
+      --count;
+      if (n->level < Levels and levels[n->level].slots[n->slot].empty())
+        clear(n->level, n->slot);
+    }
+    // Moves every timer of a list to where it belongs now.
+    void cascade(List& from) {
+      Link* n = from.head.next;
+      from.head.prev = from.head.next = &from.head;
+      while (n != &from.head) {
+        Link* next = n->next;
+        --count;
+        link(static_cast<Base*>(n), true);
+        n = next;
+      }
+    }
+    void cascade(unsigned l, uint64_t s) {
+      clear(l, s);
+      cascade(levels[l].slots[s]);
+    }
+    void fire(Base* n) {
+      n->linked = false;
+      --count;
+      if (n->state.load(std::memory_order_acquire) != Pending) {
+        n->release();
+        return;
+      }
+      Node<E>* t = static_cast<Node<E>*>(n);
+      if (not n->period) {
+        int s = Pending;
+        if (n->state.compare_exchange_strong(s, Done, std::memory_order_acq_rel)) {
+          struct Guard { Node<E>* t; ~Guard() { t->f = nullptr; t->release(); } } g {t};
+          t->f();
+        } else
+          n->release();
+        return;
+      }
+      struct Guard {
+        Wheel& w;
+        Base* n;
+        ~Guard() {
+          if (n->state.load(std::memory_order_acquire) != Pending) {
+            n->release();
+            return;
+          }
+          // Periods are kept on schedule; the ones already past the time expire() was asked for
+          // are skipped, so a late dispatcher fires a periodic timer once rather than catching up.
+          n->expiry += n->period;
+          if (n->expiry <= w.until)
+            n->expiry += ((w.until - n->expiry) / n->period + 1) * n->period;
+          w.link(n);
+        }
+      } g {*this, n};
+      t->f();
+    }
+    void drain() {
+      Base* n = stack.exchange(nullptr, std::memory_order_acquire);
+      while (n) {
+        Base* next = n->cancelled;
+        if (n->linked) {
+          unlink(n);
+          n->release(); // the wheel's reference
+        }
+        n->release();   // the stack's reference
+        n = next;
+      }
+    }
+  public:
+    explicit Wheel(Clock::duration resolution = std::chrono::milliseconds(1)) : origin(Clock::now()), resolution(resolution) {}
+    Wheel(const Wheel&) = delete;
+    Wheel& operator=(const Wheel&) = delete;
+    ~Wheel() {
+      drain();
+      auto clear = [](List& list) {
+        Link* n = list.head.next;
+        while (n != &list.head) {
+          Link* next = n->next;
+          static_cast<Base*>(n)->state.store(Done, std::memory_order_release);
+          static_cast<Base*>(n)->release();
+          n = next;
+        }
+      };
+      if (levels)
+        for (unsigned l = 0; l < Levels; ++l)
+          for (List& s: levels[l].slots)
+            clear(s);
+      clear(overflow);
+    }
+
+    // Any thread: a timer owned by this wheel, to be passed to insert() on the dispatcher.
+    template<class F> Base* make(Clock::time_point at, Clock::duration period, F&& f) {
+      Node<E>* n = new Node<E>(std::forward<F>(f));
+      n->expiry = ceil(at);
+      n->period = period.count() > 0 ? std::max<uint64_t>(1, uint64_t((period + resolution - Clock::duration(1)) / resolution)) : 0;
+      n->stack = &stack;
+      return n;
+    }
+    // Dispatcher: takes the wheel's reference to a timer from make().
+    void insert(Base* n) {
+      if (n->state.load(std::memory_order_acquire) != Pending)
+        n->release();
+      else
+        link(n);
+    }
+    // Dispatcher: the posted insert was dropped (the queue went away before running it).
+    static void discard(Base* n) {
+      n->state.store(Done, std::memory_order_release);
+      n->release();
+    }
+
+    bool empty() const { return not count and not stack.load(std::memory_order_relaxed); }
+
+    // Dispatcher: applies pending cancels and runs every timer due at t.
+    void expire(Clock::time_point t = Clock::now()) {
+      drain();
+      uint64_t target = floor(t);
+      if (target <= now)
+        return;
+      until = target;
+      if (not count) {
+        now = target;
+        return;
+      }
+      while (now < target) {
+        if (first((now & Mask) + 1) == Slots) { // nothing left in this rotation: skip to its end
+          now = std::min(now | Mask, target);
+          if (now == target)
+            return;
+        }
+        uint64_t s = ++now & Mask;
+        if (not s) {
+          unsigned l = 1;
+          while (l < Levels and not ((now >> (Bits * l)) & Mask))
+            ++l;
+          // Levels below l wrapped and level l moved to its next slot: all of them cascade,
+          // highest first, and the overflow list too once every level has wrapped.
+          if (l == Levels)
+            cascade(overflow);
+          else
+            ++l;
+          while (l-- > 1)
+            cascade(l, (now >> (Bits * l)) & Mask);
+        }
+        List& list = levels[0].slots[s];
+        clear(0, s);
+        while (not list.empty()) {
+          Link* n = list.head.next;
+          remove(n);
+          fire(static_cast<Base*>(n));
+        }
+        if (not count) {
+          now = target;
+          return;
+        }
+      }
+    }
+
+    // Dispatcher: when expire() has something to do next; a level-0 deadline, or the next wrap
+    // at which a higher level cascades. Clock::time_point::max() when no timer is linked.
+    Clock::time_point next() const {
+      if (not count)
+        return Clock::time_point::max();
+      uint64_t s = first((now & Mask) + 1);
+      return origin + resolution * int64_t((now & ~Mask) + s);
+    }
+  };
+} // timer
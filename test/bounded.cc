@@ -0,0 +1,123 @@
+// The bounded mailbox: stop() releases producers blocked on it, also those that passed the running
+// check just before, a batch cut short counts only its refused part, a dispatcher posting to its
+// own full mailbox is refused instead of waiting on itself, and timers armed or coroutines resumed
+// on a full mailbox are neither refused nor dropped.
+//   g++ -std=c++11 -O1 -g -pthread -I smunix/include -I test test/bounded.cc -o bounded.test
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <functional>
+#include <thread>
+#include <vector>
+#include <thread.hh>
+#include <test.hh>
+
+namespace {
+  using std::chrono::milliseconds;
+
+  // Runs a message that holds the dispatcher until release() so that the mailbox can be filled.
+  struct Stall {
+    std::atomic<bool> go {false};
+    template<class T> explicit Stall(T& t) {
+      std::atomic<bool> started {false};
+      std::atomic<bool>* s = &started;
+      std::atomic<bool>* g = &go;
+      t.exec([s, g]() {
+          s->store(true, std::memory_order_release);
+          while (not g->load(std::memory_order_acquire))
+            std::this_thread::yield();
+        });
+      while (not started.load(std::memory_order_acquire))
+        std::this_thread::yield();
+    }
+    void release() { go.store(true, std::memory_order_release); }
+  };
+
+  void partial() {
+    Thread<BoundedThreadTraits<4, queue::Block>> t;
+    Stall stall(t);
+    std::atomic<int> st {-1};
+    std::thread producer([&]() {
+        std::vector<std::function<void()>> fs(10, []() {});
+        st = t.exec_many(fs.begin(), fs.end());
+      });
+    std::this_thread::sleep_for(milliseconds(20)); // 4 queued, the producer waits for room
+    std::thread stopper([&]() { t.stop(); });
+    producer.join();
+    stall.release();
+    stopper.join();
+    CHECK(st == queue::Closed);
+    CHECK(t.counters().rejected == 6);
+  }
+
+  // A producer racing stop() either gets in or is refused; it never stays blocked.
+  void race() {
+    for (int r = 0; r < 200; ++r) {
+      Thread<BoundedThreadTraits<1, queue::Block>> t;
+      Stall stall(t);
+      t.exec([]() {});
+      std::thread producer([&]() { t.exec([]() {}); });
+      std::thread stopper([&]() { t.stop(); });
+      producer.join();
+      stall.release();
+      stopper.join();
+    }
+    CHECK(true);
+  }
+
+  void self() {
+    Thread<BoundedThreadTraits<4, queue::Block>> t;
+    std::atomic<size_t> ran {0};
+    std::atomic<size_t>* p = &ran;
+    std::vector<int> statuses; // written by the dispatcher, read once it is done
+    std::vector<int> batch;
+    std::atomic<bool> done {false};
+    t.exec([&]() {
+        for (int i = 0; i < 10; ++i)
+          statuses.push_back(t.exec([p]() { p->fetch_add(1); }));
+        std::vector<std::function<void()>> fs(3, [p]() { p->fetch_add(1); });
+        batch.push_back(t.exec_many(fs.begin(), fs.end()));
+        done.store(true, std::memory_order_release);
+      });
+    for (int i = 0; i < 500 and not done.load(std::memory_order_acquire); ++i)
+      std::this_thread::sleep_for(milliseconds(1));
+    CHECK(done.load());
+    while (ran.load() < 4 and done.load())
+      std::this_thread::yield();
+    t.stop();
+    CHECK(statuses.size() == 10);
+    for (size_t i = 0; i < statuses.size(); ++i)
+      CHECK(statuses[i] == (i < 4 ? queue::Accepted : queue::Full));
+    CHECK(batch.size() == 1 and batch[0] == queue::Full);
+    CHECK(ran.load() == 4);
+    CHECK(t.counters().rejected == 6 + 3);
+  }
+
+  template<queue::Overflow Policy> void timers() {
+    Thread<BoundedThreadTraits<2, Policy>> t;
+    std::atomic<int> fired {0};
+    std::atomic<int>* f = &fired;
+    Stall stall(t);
+    t.exec([]() {});
+    t.exec([]() {});
+    timer::Handle h = t.exec_after(milliseconds(1), [f]() { f->fetch_add(1); });
+    for (int i = 0; i < 4; ++i)
+      t.exec([]() {}); // refused, or dropping older messages
+    CHECK(h);
+    stall.release();
+    for (int i = 0; i < 1000 and not fired.load(); ++i)
+      std::this_thread::sleep_for(milliseconds(1));
+    CHECK(fired.load() == 1);
+    CHECK(not h.pending());
+    t.stop();
+  }
+} // namespace
+
+int main() {
+  partial();
+  race();
+  self();
+  timers<queue::Fail>();
+  timers<queue::DropOldest>();
+  return test::result();
+}
@@ -0,0 +1,85 @@
+// Strands on an Executor: a strand destroyed while it is queued or a worker still drains it waits
+// for the drain, and posting to a strand whose executor has stopped is refused with Closed.
+//   g++ -std=c++11 -O1 -g -pthread -I smunix/include -I test test/executor.cc -o executor.test
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <functional>
+#include <memory>
+#include <vector>
+#include <executor.hh>
+#include <test.hh>
+
+namespace {
+  void destroy() {
+    sched::Executor executor(2);
+    for (int r = 0; r < 100; ++r) {
+      size_t ran = 0; // only touched by the strand's messages, then read after its destruction
+      size_t* p = &ran;
+      {
+        std::unique_ptr<sched::Strand> s(new sched::Strand(executor));
+        for (int i = 0; i < 1000; ++i)
+          CHECK(s->exec([p]() { ++*p; }) == queue::Accepted);
+      }
+      CHECK(ran == 1000);
+    }
+  }
+
+  // A strand queued behind a worker busy with another strand: its destructor must wait for the
+  // worker to get to it and finish, not return once the worker has merely unscheduled it.
+  void queued() {
+    sched::Executor executor(1);
+    for (int r = 0; r < 20; ++r) {
+      sched::Strand busy(executor);
+      std::atomic<bool> go {false};
+      std::atomic<bool>* g = &go;
+      busy.exec([g]() {
+          while (not g->load(std::memory_order_acquire))
+            std::this_thread::yield();
+        });
+      std::atomic<size_t> ran {0};
+      std::atomic<size_t>* p = &ran;
+      std::unique_ptr<sched::Strand> s(new sched::Strand(executor));
+      for (int i = 0; i < 3; ++i)
+        CHECK(s->exec([p]() { p->fetch_add(1); }) == queue::Accepted);
+      std::atomic<bool> destroyed {false};
+      std::thread destroyer([&]() {
+          s.reset();
+          destroyed.store(true);
+        });
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      CHECK(not destroyed.load()); // still queued behind busy
+      go.store(true, std::memory_order_release);
+      destroyer.join();
+      CHECK(ran.load() == 3);
+    }
+  }
+
+  void stopped() {
+    sched::Executor executor(1);
+    sched::Strand s(executor);
+    std::atomic<bool> go {false};
+    std::atomic<bool>* g = &go;
+    CHECK(s.exec([g]() {
+          while (not g->load(std::memory_order_acquire))
+            std::this_thread::yield();
+        }) == queue::Accepted);
+    sched::Strand queued(executor);
+    CHECK(queued.exec([]() {}) == queue::Accepted); // waits behind the busy worker
+    std::thread stopper([&]() { executor.stop(); });
+    while (not executor.stopped())
+      std::this_thread::yield();
+    go.store(true, std::memory_order_release);
+    stopper.join();
+    CHECK(s.exec([]() {}) == queue::Closed);
+    std::vector<std::function<void()>> fs(3, []() {});
+    CHECK(s.exec_many(fs.begin(), fs.end()) == queue::Closed);
+  } // queued was left scheduled by the stopped executor; destroying it must not wait
+} // namespace
+
+int main() {
+  destroy();
+  queued();
+  stopped();
+  return test::result();
+}
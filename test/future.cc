@@ -0,0 +1,137 @@
+// Request/reply: ask() and get() round trips, exceptions and broken promises carried to get(), and,
+// built as C++20, coroutines awaiting ask() that resume on the Thread<> or Strand they started on.
+//   g++ -std=c++11 -O1 -g -pthread -I smunix/include -I test test/future.cc -o future.test
+//   g++ -std=c++20 -O1 -g -pthread -I smunix/include -I test test/future.cc -o future.test
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <actor.hh>
+#include <test.hh>
+
+namespace {
+  using Mpsc = Thread<MpscThreadTraits>;
+
+  template<class F> std::future_errc error(F& f) {
+    try {
+      f.get();
+    } catch(std::future_error& e) {
+      return std::future_errc(e.code().value());
+    } catch(...) {
+    }
+    return std::future_errc();
+  }
+
+  void round_trips() {
+    Mpsc t;
+    BasicActor<Mpsc> a(t);
+    CHECK(a.ask([]() { return 42; }).get() == 42);
+    CHECK(a.ask([]() { return std::string(100, 'x'); }).get() == std::string(100, 'x'));
+    std::thread::id there = a.ask([]() { return std::this_thread::get_id(); }).get();
+    CHECK(there != std::this_thread::get_id());
+    a.ask([]() {}).get();
+    for (int i = 0; i < 1000; ++i)
+      CHECK(a.ask([i]() { return i; }).get() == i);
+    bool thrown = false;
+    try {
+      a.ask([]() -> int { throw std::runtime_error("boom"); }).get();
+    } catch(std::runtime_error& e) {
+      thrown = std::string(e.what()) == "boom";
+    }
+    CHECK(thrown);
+    { auto f = a.ask([]() { return 1; }); } // dropped unread
+    t.stop();
+  }
+
+  void broken() {
+    {
+      future::Future<int> f;
+      {
+        future::Promise<int> p;
+        f = p.get_future();
+      }
+      CHECK(f.ready());
+      CHECK(error(f) == std::future_errc::broken_promise);
+    }
+    // ask() on a stopped thread: the refused message drops its promise.
+    Thread<> t;
+    Actor a(t);
+    t.stop();
+    future::Future<int> f = a.ask([]() { return 1; });
+    CHECK(error(f) == std::future_errc::broken_promise);
+  }
+
+#if SMUNIX_COROUTINES
+  // Hops to `to` and back n times; every resumption must be on `home`.
+  template<class A> future::Future<int> hops(A& to, std::thread::id home, int n, std::atomic<int>& strays) {
+    int sum = 0;
+    for (int i = 0; i < n; ++i) {
+      std::thread::id there = co_await to.ask([]() { return std::this_thread::get_id(); });
+      if (there == home or std::this_thread::get_id() != home)
+        ++strays;
+      sum += co_await to.ask([i]() { return i; });
+      if (std::this_thread::get_id() != home)
+        ++strays;
+    }
+    co_return sum;
+  }
+
+  void coroutine_on_thread() {
+    Mpsc t1, t2;
+    BasicActor<Mpsc> a(t1), b(t2);
+    std::atomic<int> result {-1}, strays {0};
+    b.dispatch([&]() {
+        [](BasicActor<Mpsc>& a, std::atomic<int>& result, std::atomic<int>& strays) -> future::Future<void> {
+          result = co_await hops(a, std::this_thread::get_id(), 100, strays);
+        }(a, result, strays);
+      });
+    while (result.load() < 0)
+      std::this_thread::yield();
+    CHECK(result.load() == 99 * 100 / 2);
+    CHECK(strays.load() == 0);
+  }
+
+  // On a one-worker executor, resuming on the strand means resuming on that worker.
+  void coroutine_on_strand() {
+    Mpsc t;
+    BasicActor<Mpsc> a(t);
+    sched::Executor executor(1);
+    sched::Strand strand(executor);
+    BasicActor<sched::Strand> s(strand);
+    std::atomic<int> result {-1}, strays {0};
+    s.dispatch([&]() {
+        [](BasicActor<Mpsc>& a, std::atomic<int>& result, std::atomic<int>& strays) -> future::Future<void> {
+          result = co_await hops(a, std::this_thread::get_id(), 100, strays);
+        }(a, result, strays);
+      });
+    while (result.load() < 0)
+      std::this_thread::yield();
+    CHECK(result.load() == 99 * 100 / 2);
+    CHECK(strays.load() == 0);
+  }
+
+  // Awaited from a thread that is no executor, the coroutine resumes inline where the reply is set.
+  void coroutine_inline() {
+    Mpsc t;
+    BasicActor<Mpsc> a(t);
+    auto top = [](BasicActor<Mpsc>& a) -> future::Future<int> {
+      int x = co_await a.ask([]() { return 5; });
+      co_return x + 1;
+    }(a);
+    CHECK(top.get() == 6);
+  }
+#endif
+} // namespace
+
+int main() {
+  round_trips();
+  broken();
+#if SMUNIX_COROUTINES
+  coroutine_on_thread();
+  coroutine_on_strand();
+  coroutine_inline();
+#endif
+  return test::result();
+}
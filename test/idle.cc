@@ -0,0 +1,75 @@
+// Polling dispatchers: a Thread<> idling with Spin, SpinYield or Adaptive wakes for a message
+// posted while it idles, for a timer, and for a message posted while a timer is pending, and
+// runs under the name and on the CPU its Placement gives it.
+//   g++ -std=c++11 -O1 -g -pthread -I smunix/include -I test test/idle.cc -o idle.test
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <thread.hh>
+#include <test.hh>
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  // Waits up to 5s for f to hold.
+  template<class F> bool eventually(F f) {
+    Clock::time_point end = Clock::now() + std::chrono::seconds(5);
+    while (not f() and Clock::now() < end)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return f();
+  }
+
+  template<class S> void placed(const char* name) {
+    Placement p;
+    p.name = name;
+    p.cpu = 0;
+    Thread<MpscThreadTraits, true, S> t(true, p);
+
+    // A message posted once the dispatcher has gone idle.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::atomic<bool> ran {false}, named {false}, pinned {false};
+    t.exec([&]() {
+        char buf[16] = {};
+        named = pthread_getname_np(pthread_self(), buf, sizeof(buf)) == 0 and std::string(buf) == std::string(name).substr(0, 15);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        pinned = sched_getaffinity(0, sizeof(set), &set) == 0 and CPU_COUNT(&set) == 1 and CPU_ISSET(0, &set);
+        ran = true;
+      });
+    CHECK(eventually([&]() { return ran.load(); }));
+    CHECK(named);
+    CHECK(pinned);
+
+    // A timer on an otherwise idle dispatcher.
+    std::atomic<bool> fired {false};
+    Clock::time_point armed = Clock::now();
+    t.exec_after(std::chrono::milliseconds(10), [&]() { fired = true; });
+    CHECK(eventually([&]() { return fired.load(); }));
+    CHECK(Clock::now() - armed >= std::chrono::milliseconds(10));
+
+    // A message while the dispatcher idles toward a far deadline.
+    std::atomic<bool> late {false};
+    timer::Handle h = t.exec_after(std::chrono::seconds(60), [&]() { late = true; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ran = false;
+    t.exec([&]() { ran = true; });
+    CHECK(eventually([&]() { return ran.load(); }));
+    CHECK(h.cancel());
+    CHECK(not late);
+    t.stop();
+  }
+} // namespace
+
+int main() {
+  placed<idle::Spin>("spin");
+  placed<idle::SpinYield<>>("spin-yield");
+  placed<idle::Adaptive<>>("adaptive-dispatcher"); // longer than Linux keeps
+  return test::result();
+}
@@ -0,0 +1,88 @@
+// The closure pool: blocks freed on another thread go back to their owner's remote list and are
+// handed out again before the owner takes a new slab, and the cache of an exited thread, with
+// the blocks freed into it after the exit, is taken over by the next thread to allocate.
+//   g++ -std=c++11 -O1 -g -pthread -I smunix/include -I test test/pool.cc -o pool.test
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <set>
+#include <thread>
+#include <vector>
+#include <pool.hh>
+#include <test.hh>
+
+namespace {
+  constexpr size_t Size = 256;
+  constexpr size_t N = 1000; // about four slabs of the class
+
+  std::vector<void*> allocate(size_t n) {
+    std::vector<void*> v;
+    for (size_t i = 0; i < n; ++i)
+      v.push_back(pool::allocate(Size));
+    return v;
+  }
+
+  // Allocates until the pool takes a new slab: everything it had for the class so far.
+  std::vector<void*> drain() {
+    std::vector<void*> v;
+    uint64_t refills = pool::stats().refills;
+    while (pool::stats().refills == refills)
+      v.push_back(pool::allocate(Size));
+    return v;
+  }
+
+  size_t found(const std::vector<void*>& blocks, const std::vector<void*>& in) {
+    std::set<void*> s(in.begin(), in.end());
+    size_t n = 0;
+    for (void* p: blocks)
+      n += s.count(p);
+    return n;
+  }
+
+  void remote() {
+    pool::Stats s0 = pool::stats();
+    std::vector<void*> blocks = allocate(N);
+    pool::Stats s1 = pool::stats();
+    CHECK(s1.allocations - s0.allocations == N);
+    CHECK(s1.refills - s0.refills >= N * Size / pool::Slab);
+
+    std::thread([&]() {
+        for (void* p: blocks)
+          pool::deallocate(p, Size);
+      }).join();
+    pool::Stats s2 = pool::stats();
+    CHECK(s2.remote - s1.remote == N);
+    CHECK(s2.deallocations == s1.deallocations);
+
+    // The owner's free list runs dry, then the remote list refills it without a new slab.
+    std::vector<void*> again = drain();
+    pool::Stats s3 = pool::stats();
+    CHECK(s3.refills - s2.refills == 1);
+    CHECK(again.size() > N);
+    CHECK(found(blocks, again) == N);
+
+    for (void* p: again)
+      pool::deallocate(p, Size);
+    pool::Stats s4 = pool::stats();
+    CHECK(s4.deallocations - s3.deallocations == again.size());
+    CHECK(s4.remote == s3.remote);
+  }
+
+  void orphan() {
+    std::vector<void*> blocks;
+    std::thread([&]() { blocks = allocate(N); }).join();
+    for (void* p: blocks)
+      pool::deallocate(p, Size);
+    std::vector<void*> again;
+    std::thread([&]() { again = drain(); }).join();
+    CHECK(found(blocks, again) == N);
+    for (void* p: again)
+      pool::deallocate(p, Size);
+  }
+} // namespace
+
+int main() {
+  remote();
+  orphan();
+  return test::result();
+}
@@ -0,0 +1,70 @@
+// The ring mailbox: a dispatcher posting to its own full ring does not wait on itself and runs
+// those messages in order, and stop() releases producers parked on a full ring.
+//   g++ -std=c++11 -O1 -g -pthread -I smunix/include -I test test/ring.cc -o ring.test
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <array>
+#include <thread>
+#include <vector>
+#include <thread.hh>
+#include <test.hh>
+
+namespace {
+  struct SmallRingTraits {
+    using Element = smunix::function<void(), 8>;
+    using Queue = queue::Ring<4096>;
+  };
+  using Small = Thread<SmallRingTraits>;
+
+  void self() {
+    constexpr size_t N = 200;
+    std::vector<size_t> order;
+    std::atomic<bool> done {false};
+    std::vector<size_t>* o = &order;
+    std::atomic<bool>* d = &done;
+    Small t;
+    t.exec([&t, o, d]() {
+        for (size_t i = 0; i < N; ++i) {
+          std::array<char, 64> pad {};
+          t.exec([o, i, pad]() { o->push_back(i + pad[0]); });
+        }
+        t.exec([d]() { d->store(true, std::memory_order_release); });
+      });
+    while (not done.load(std::memory_order_acquire))
+      std::this_thread::yield();
+    t.stop();
+    CHECK(order.size() == N);
+    for (size_t i = 0; i < order.size(); ++i)
+      CHECK(order[i] == i);
+  }
+
+  void stop() {
+    std::atomic<bool> release {false};
+    std::atomic<bool>* r = &release;
+    Small t;
+    t.exec([r]() {
+        while (not r->load(std::memory_order_acquire))
+          std::this_thread::yield();
+      });
+    std::atomic<size_t> closed {0};
+    std::thread producer([&]() {
+        for (size_t i = 0; i < 1000; ++i)
+          if (t.exec([]() {}) == queue::Closed)
+            closed.fetch_add(1);
+      });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // the producer parks on the full ring
+    std::thread stopper([&]() { t.stop(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    release.store(true, std::memory_order_release);
+    stopper.join();
+    producer.join();
+    CHECK(closed.load() > 0);
+  }
+} // namespace
+
+int main() {
+  self();
+  stop();
+  return test::result();
+}
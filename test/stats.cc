@@ -0,0 +1,49 @@
+// Mailbox counters: one producer feeding two mailboxes in turn samples both of them.
+//   g++ -std=c++11 -O1 -g -pthread -I smunix/include -I test test/stats.cc -o stats.test
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <thread>
+#include <thread.hh>
+#include <test.hh>
+
+namespace {
+  void alternating() {
+    constexpr size_t N = 100 * stats::Period;
+    stats::Mailbox a, b;
+    for (size_t i = 0; i < N; ++i) {
+      a.dequeue(a.enqueue());
+      b.dequeue(b.enqueue());
+    }
+    stats::Queue qa = a.snapshot(), qb = b.snapshot();
+    CHECK(qa.sampled == N / stats::Period);
+    CHECK(qb.sampled == N / stats::Period);
+  }
+
+  // The same through two Thread<>s, with a backlog for the samples to see.
+  void threads() {
+    constexpr size_t N = 100 * stats::Period;
+    Thread<MpscThreadTraits> t1(false), t2(false);
+    for (size_t i = 0; i < N; ++i) {
+      t1.exec([]() {});
+      t2.exec([]() {});
+    }
+    t1.start();
+    t2.start();
+    while (t1.counters().dequeued != N or t2.counters().dequeued != N)
+      std::this_thread::yield();
+    stats::Queue q1 = t1.counters(), q2 = t2.counters();
+    CHECK(q1.sampled == N / stats::Period);
+    CHECK(q2.sampled == N / stats::Period);
+    CHECK(q1.max_depth > 0);
+    CHECK(q2.max_depth > 0);
+  }
+} // namespace
+
+int main() {
+#if SMUNIX_STATS
+  alternating();
+  threads();
+#endif
+  return test::result();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdio>
+
+// Minimal checks shared by the tests in this directory; a test exits non-zero if any check failed.
+//   g++ -std=c++11 -O1 -g -pthread -I smunix/include -I test test/<name>.cc && ./a.out
+namespace test {
+  inline int& failures() {
+    static int n = 0;
+    return n;
+  }
+  inline void check(bool ok, const char* what, const char* file, int line) {
+    if (ok)
+      return;
+    ++failures();
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+  }
+  inline int result() {
+    if (failures())
+      std::fprintf(stderr, "%d check(s) failed\n", failures());
+    return failures() ? 1 : 0;
+  }
+} // test
+
+#define CHECK(e) test::check(bool(e), #e, __FILE__, __LINE__)
@@ -0,0 +1,104 @@
+// Timers due on a wheel level boundary fire on that very tick, periodic ones stay on their grid
+// across boundaries, and a periodic timer on a dispatcher that stalls for many periods fires once
+// when the dispatcher comes back, then keeps its original schedule, instead of running every
+// missed period in a row.
+//   g++ -std=c++11 -O1 -g -pthread -I smunix/include -I test test/timer.cc -o timer.test
+#ifndef SMUNIX_LOG_LEVEL
+#define SMUNIX_LOG_LEVEL SMUNIX_LOG_OFF
+#endif
+#include <thread>
+#include <thread.hh>
+#include <test.hh>
+
+namespace {
+  using Clock = timer::Clock;
+  using std::chrono::milliseconds;
+  using Element = smunix::function<void(), 8>;
+
+  // The wheel alone, on an exact clock.
+  void wheel() {
+    timer::Wheel<Element> w;
+    size_t fired = 0;
+    size_t* f = &fired;
+    Clock::time_point t0 = Clock::now();
+    timer::Base* n = w.make(t0 + milliseconds(10), milliseconds(10), [f]() { ++*f; });
+    timer::Handle h(n);
+    w.insert(n);
+    w.expire(t0 + milliseconds(15));
+    CHECK(fired == 1);
+    w.expire(t0 + milliseconds(4015)); // 400 periods late
+    CHECK(fired == 2);
+    w.expire(t0 + milliseconds(4019));
+    CHECK(fired == 2);
+    w.expire(t0 + milliseconds(4021)); // back on the 10 ms grid
+    CHECK(fired == 3);
+    h.cancel();
+  }
+
+  // Ticks of one second: the wheel's origin is a hair before t0, so a deadline half a tick short
+  // of tick k lands on k, and expiring a quarter tick either side of k tells whether it fired on k.
+  using Ticks = std::chrono::duration<int64_t, std::ratio<1>>;
+  Clock::duration tick(double k) { return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(k)); }
+
+  void boundaries() {
+    for (uint64_t k: {255, 256, 257, 512, 65535, 65536, 65537}) {
+      timer::Wheel<Element> w(Ticks(1));
+      Clock::time_point t0 = Clock::now();
+      size_t fired = 0;
+      size_t* f = &fired;
+      timer::Base* n = w.make(t0 + tick(k - 0.5), Clock::duration::zero(), [f]() { ++*f; });
+      w.insert(n);
+      w.expire(t0 + tick(k - 0.25));
+      CHECK(fired == 0);
+      w.expire(t0 + tick(k + 0.25));
+      CHECK(fired == 1);
+    }
+  }
+
+  // A 128-tick period crosses a level-0 wrap every other time.
+  void grid() {
+    timer::Wheel<Element> w(Ticks(1));
+    Clock::time_point t0 = Clock::now();
+    size_t fired = 0;
+    size_t* f = &fired;
+    timer::Base* n = w.make(t0 + tick(127.5), tick(128), [f]() { ++*f; });
+    timer::Handle h(n);
+    w.insert(n);
+    for (size_t i = 1; i <= 8; ++i) {
+      w.expire(t0 + tick(128 * i - 0.25));
+      CHECK(fired == i - 1);
+      w.expire(t0 + tick(128 * i + 0.25));
+      CHECK(fired == i);
+    }
+    h.cancel();
+  }
+
+  // A Thread<> whose dispatcher is stuck in a message for 400 periods.
+  void stall() {
+    std::atomic<size_t> fired {0};
+    std::atomic<size_t>* f = &fired;
+    Thread<> t;
+    timer::Handle h = t.exec_every(milliseconds(10), [f]() { f->fetch_add(1, std::memory_order_relaxed); });
+    std::atomic<bool> stalled {false};
+    std::atomic<bool>* s = &stalled;
+    t.exec([s]() {
+        std::this_thread::sleep_for(milliseconds(4000));
+        s->store(true, std::memory_order_release);
+      });
+    while (not stalled.load(std::memory_order_acquire))
+      std::this_thread::sleep_for(milliseconds(1));
+    std::this_thread::sleep_for(milliseconds(5));
+    h.cancel();
+    t.stop();
+    CHECK(fired.load() >= 1);
+    CHECK(fired.load() <= 3); // the late one, and at most one or two on schedule after it
+  }
+} // namespace
+
+int main() {
+  wheel();
+  boundaries();
+  grid();
+  stall();
+  return test::result();
+}